@@ -8,8 +8,8 @@ OrthographicCamera::OrthographicCamera
     Camera(std::move(f), lf, la, up, sw) {}
 
 
-Ray OrthographicCamera::generate_ray(int i, int j) {
-    auto [u2,v2] = get_uv(i,j);
+Ray OrthographicCamera::generate_ray(int i, int j, Point2f offset) {
+    auto [u2,v2] = get_uv(i,j,offset);
     Vector3f dir = w; // Expendable
     return Ray{e + (u * u2) + (v * v2), dir};
 }
@@ -10,7 +10,8 @@ public:
     OrthographicCamera(std::unique_ptr<Film> &&film, Point3f lf, Point3f la, Vector3f up, ScreenWindow sw);
     ~OrthographicCamera() = default;
 
-    Ray generate_ray(int i, int j) override;
+    using Camera::generate_ray;
+    Ray generate_ray(int i, int j, Point2f offset) override;
 };
 
 OrthographicCamera* create_orthographic_camera(
@@ -6,8 +6,8 @@ PerspectiveCamera::PerspectiveCamera
     (std::unique_ptr<Film> && f, Point3f lf, Point3f la, Vector3f up, ScreenWindow sw) :
     Camera(std::move(f), lf, la, up, sw) {}
 
-Ray PerspectiveCamera::generate_ray(int i, int j) {
-    auto [u2, v2] = get_uv(i, j);
+Ray PerspectiveCamera::generate_ray(int i, int j, Point2f offset) {
+    auto [u2, v2] = get_uv(i, j, offset);
     Vector3f dir = w + (u * u2) + (v * v2);
     return Ray{e, dir};
 }
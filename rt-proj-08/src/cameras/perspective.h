@@ -10,7 +10,8 @@ public:
     PerspectiveCamera(std::unique_ptr<Film> &&film, Point3f lf, Point3f la, Vector3f up, ScreenWindow sw);
     ~PerspectiveCamera() = default;
 
-    Ray generate_ray(int i, int j) override;
+    using Camera::generate_ray;
+    Ray generate_ray(int i, int j, Point2f offset) override;
 };
 
 PerspectiveCamera* create_perspective_camera(
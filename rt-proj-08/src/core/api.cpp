@@ -1,7 +1,10 @@
 #include "api.h"
 
+#include <algorithm>
 #include <chrono>
 #include <memory>
+#include <mutex>
+#include <numeric>
 #include "color.h"
 #include "../materials/flat.h"
 #include "../integrators/ping_pong.h"
@@ -13,6 +16,10 @@
 #include "../lights/spot.h"
 #include "../lights/directional.h"
 #include "../shapes/triangle.h"
+#include "../shapes/rt3mesh.h"
+#include "../shapes/ply_reader.h"
+#include "../shapes/geometry_cache.h"
+#include "file_watcher.h"
 
 namespace rt3 {
 
@@ -21,14 +28,20 @@ namespace rt3 {
 API::APIState API::curr_state = APIState::Uninitialized;
 RunningOptions API::curr_run_opt;
 std::unique_ptr<RenderOptions> API::render_opt;
+std::unique_ptr<SceneBuild> API::last_build;
 vector<tuple<ParamSet, shared_ptr<Material>, shared_ptr<Transform>>> API::global_primitives;
 vector<tuple<shared_ptr<TriangleMesh>, shared_ptr<Material>, shared_ptr<Transform>>> API::global_mesh_primitives;
+vector<tuple<ParamSet, Bounds3f, shared_ptr<Material>, shared_ptr<Transform>>> API::global_lazy_meshes;
 shared_ptr<Material> API::curr_material;
 std::map<string, shared_ptr<Material>> API::named_materials;
+vector<shared_ptr<Material>> API::materials;
 vector<ParamSet> API::lights;
 ObjectBuild API::obj_build;
 std::map<string, shared_ptr<ObjectBuild>> API::named_obj_build;
 std::map<string, shared_ptr<TriangleMesh>> API::meshes;
+std::map<string, int> API::mesh_idle;
+std::set<string> API::watched_files;
+JobStats API::job_stats;
 Transform API::curr_TM;
 std::stack<shared_ptr<Transform>> API::saved_TM;
 string API::curr_obj = "";
@@ -38,10 +51,10 @@ string API::curr_obj = "";
 // THESE FUNCTIONS ARE NEEDED ONLY IN THIS SOURCE FILE (NO HEADER NECESSARY)
 // ˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇˇ
 
-Film* API::make_film(const std::string& name, const ParamSet& ps) {
+Film* API::make_film(const std::string& name, const ParamSet& ps, int frame) {
   std::cout << ">>> Inside API::make_film()\n";
   Film* film{ nullptr };
-  film = create_film(ps);
+  film = create_film(ps, frame);
 
   // Return the newly created film.
   return film;
@@ -89,7 +102,7 @@ Camera* API::make_camera(const ParamSet &ps_camera, const ParamSet &ps_lookat, u
   return cam;
 }
 
-Material * API::make_material(const ParamSet &ps_material)
+shared_ptr<Material> API::make_material(const ParamSet &ps_material)
 {
     std::cout << ">>> Inside API::make_material()\n";
     std::string type = retrieve(ps_material, "type", std::string{ "flat" });
@@ -104,8 +117,10 @@ Material * API::make_material(const ParamSet &ps_material)
         RT3_ERROR("Uknown material type.");
     }
     std::cout << "RETURNED" << std::endl;
-    // Return the newly created material
-    return material;
+    // Register the newly created material, so the scene's material table has it, and return it.
+    materials.push_back(shared_ptr<Material>(material));
+    material->id = materials.size();
+    return materials.back();
 }
 
 Integrator * API::make_integrator(const ParamSet &ps_integrator, unique_ptr<Camera> &&camera) {
@@ -180,6 +195,103 @@ vector<Shape*> API::make_triangles(shared_ptr<TriangleMesh> tm) {
   return shapes;
 }
 
+/// Guards `API::meshes` when lazy meshes are loaded from the render.
+static std::mutex meshes_mutex;
+
+shared_ptr<TriangleMesh> API::load_mesh(const ParamSet &ps) {
+  shared_ptr<TriangleMesh> tm = try_load_mesh(ps);
+  if(not tm) {
+    RT3_ERROR("Couldn't load mesh file");
+  }
+  return tm;
+}
+
+shared_ptr<TriangleMesh> API::try_load_mesh(const ParamSet &ps) {
+  string filename = retrieve(ps, "filename", string());
+
+  if(meshes.count(filename) == 0) {
+    shared_ptr<TriangleMesh> tm{new TriangleMesh()};
+
+    bool status = false;
+    if(is_rt3mesh_file(filename)) {
+      // Binary meshes are mapped as they are; the mesh modifiers were applied by the converter.
+      status = load_rt3mesh(filename, tm);
+    } else if(is_ply_file(filename)) {
+      status = load_ply(
+        filename,
+        retrieve(ps, "reverse_vertex_order", false),
+        retrieve(ps, "compute_normals", false),
+        retrieve(ps, "flip_normals", false),
+        tm
+      );
+    } else {
+      status = load_mesh_data(
+        filename,
+        retrieve(ps, "reverse_vertex_order", false),
+        retrieve(ps, "compute_normals", false),
+        retrieve(ps, "flip_normals", false),
+        tm
+      );
+    }
+
+    if(status){
+      tm->backface_cull = retrieve(ps, "backface_cull", tm->backface_cull);
+    }else{
+      RT3_WARNING("Couldn't load mesh file \"" + filename + "\".");
+      return nullptr;
+    }
+
+    meshes[filename] = tm;
+  }
+
+  return meshes[filename];
+}
+
+/// Object space bounds of a lazy mesh: from the scene, a `.bounds` sidecar or a `.rt3mesh` header.
+static bool lazy_mesh_bounds(const ParamSet &ps, const string &filename, Bounds3f &box) {
+  if(ps.count("bounds_min") and ps.count("bounds_max")) {
+    box = Bounds3f(retrieve(ps, "bounds_min", Point3f{}), retrieve(ps, "bounds_max", Point3f{}));
+    return true;
+  }
+  if(load_bounds_sidecar(filename, box)) return true;
+  return is_rt3mesh_file(filename) and read_rt3mesh_bounds(filename, box);
+}
+
+/// Adds the geometry of `mesh` to `fp`.
+static void add_mesh(Fingerprint &fp, const TriangleMesh &mesh) {
+  fp.add(mesh.n_triangles);
+  fp.add(mesh.backface_cull);
+  fp.add_bytes(mesh.vertex_indices.data(), mesh.vertex_indices.size() * sizeof(int));
+  fp.add_bytes(mesh.normal_indices.data(), mesh.normal_indices.size() * sizeof(int));
+  fp.add_bytes(mesh.vertices.data(), mesh.vertices.size() * sizeof(Point3f));
+  fp.add_bytes(mesh.normals.data(), mesh.normals.size() * sizeof(Normal3f));
+}
+
+/// Lookat of frame `frame` of `n_frames`: the camera path's keyframes are evenly spread over the
+/// frames and linearly interpolated. Values missing from the path come from the scene's lookat.
+static ParamSet frame_lookat(const ParamSet &path_ps, const ParamSet &lookat_ps, int frame, int n_frames) {
+  auto keys = [&](const string &key, Vector3f fallback) {
+    return retrieve(path_ps, key, vector<Vector3f>{ retrieve(lookat_ps, key, fallback) });
+  };
+  const vector<Vector3f> from = keys("look_from", Point3f{ 0, 0.1, 0 });
+  const vector<Vector3f> at = keys("look_at", Point3f{ 0, 0.1, 0 });
+  const vector<Vector3f> up = keys("up", Vector3f{ 0, 0.1, 0 });
+
+  // Position along the path, in keyframes.
+  real_type t = (n_frames > 1) ? real_type(frame) / (n_frames - 1) * (from.size() - 1) : 0;
+  auto interpolate = [t](const vector<Vector3f> &v) {
+    if (v.size() == 1) return v[0];
+    int k = std::min(int(t), int(v.size()) - 2);
+    return Lerp(t - k, v[k], v[k + 1]);
+  };
+
+  ParamSet ps;
+  ps["look_from"] = std::make_shared<Value<Point3f>>(interpolate(from));
+  ps["look_at"] = std::make_shared<Value<Point3f>>(interpolate(at));
+  ps["up"] = std::make_shared<Value<Vector3f>>(interpolate(up));
+  return ps;
+}
+
 // ˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆˆ
 // END OF THE AUXILIARY FUNCTIONS
 // =========================================================================
@@ -192,10 +304,13 @@ void API::init_engine(const RunningOptions& opt) {
   if (curr_state != APIState::Uninitialized) {
     RT3_ERROR("API::init_engine() has already been called! ");
   }
-  // Set proper machine state
-  curr_state = APIState::SetupBlock;
-  // Preprare render infrastructure for a new scene.
-  render_opt = std::make_unique<RenderOptions>();
+  // Set proper machine state, and preprare render infrastructure for a new scene.
+  reset_world();
+  job_stats = JobStats();
+  // Only `--watch` uses them; a resident process that does not would collect every file of every job.
+  if (not opt.watch) {
+    watched_files.clear();
+  }
   // Create a new initial GS
   // curr_GS = GraphicsState();
   RT3_MESSAGE("[1] Rendering engine initiated.\n");
@@ -209,10 +324,18 @@ void API::clean_up() {
     RT3_ERROR("API::clean_up() called inside world definition section.");
   }
   curr_state = APIState::Uninitialized;
+  if (not curr_run_opt.resident) {
+    last_build.reset();
+  }
 
   RT3_MESSAGE("[4] Rendering engine clean up concluded. Shutting down...\n");
 }
 
+void API::abort_job() {
+  reset_world();
+  curr_state = APIState::Uninitialized;
+}
+
 void API::run() {
   // Try to load and parse the scene from a file.
   RT3_MESSAGE("[2] Beginning scene file parsing...\n");
@@ -220,18 +343,110 @@ void API::run() {
   parse(curr_run_opt.filename.c_str());
 }
 
+void API::watch() {
+  // A broken scene file must not end the session: the next save may fix it.
+  throw_on_error(true);
+  curr_run_opt.resident = true;
+  FileWatcher watcher;
+  for (;;) {
+    try {
+      run();
+    } catch (const std::exception& e) {
+      // RT3Error, or whatever else a render thread threw; the job's half-built state goes.
+      abort_job();
+      RT3_MESSAGE("    The scene could not be rendered (" + string{ e.what() } + "); waiting for it to be fixed.\n");
+    }
+
+    for (const string& filename : watched_files) {
+      if (not watcher.watch(filename)) {
+        RT3_WARNING("Could not watch \"" + filename + "\" for changes.");
+      }
+    }
+    RT3_MESSAGE("    Watching " + std::to_string(watched_files.size()) + " files for changes (Ctrl-C to quit)...\n");
+
+    for (const string& path : watcher.wait()) {
+      RT3_MESSAGE("    Changed: " + path + "\n");
+      // The mesh is read again on the next run; the others come from `meshes`.
+      for (auto it = meshes.begin(); it != meshes.end();) {
+        it = (FileWatcher::absolute_path(it->first) == path) ? meshes.erase(it) : std::next(it);
+      }
+    }
+    reset_world();
+  }
+}
+
+void API::reset_world() {
+  curr_state = APIState::SetupBlock;
+  render_opt = std::make_unique<RenderOptions>();
+  global_primitives.clear();
+  global_mesh_primitives.clear();
+  global_lazy_meshes.clear();
+  curr_material = nullptr;
+  named_materials.clear();
+  materials.clear();
+  lights.clear();
+  curr_TM = Transform();
+  saved_TM = {};
+  curr_obj = "";
+  obj_build = ObjectBuild();
+  named_obj_build.clear();
+}
+
 void API::world_begin() {
   VERIFY_SETUP_BLOCK("API::world_begin");  // check for correct machine state.
   curr_state = APIState::WorldBlock;       // correct machine state.
 }
 
-void API::world_end() {
-  VERIFY_WORLD_BLOCK("API::world_end");
-  // The scene has been properly set up and the scene has
-  // already been parsed. It's time to render the scene.
+uint64_t API::world_fingerprint() {
+  Fingerprint fp;
+  auto add_placement = [&](const shared_ptr<Material> &mat, const shared_ptr<Transform> &tr) {
+    fp.add(mat ? mat->id : 0);
+    fp.add(tr->m);
+  };
+
+  fp.add(render_opt->bkg_type);
+  add_to(fp, render_opt->bkg_ps);
+  add_to(fp, render_opt->accelerator_ps);
+  fp.add(curr_run_opt.max_geometry_mem);
+
+  fp.add(global_primitives.size());
+  for(auto &[obj_ps, mat, tr] : global_primitives) {
+    add_to(fp, obj_ps);
+    add_placement(mat, tr);
+  }
+  // Instances share their mesh; its vertices are hashed once, then referred to by number.
+  std::map<const TriangleMesh*, size_t> seen;
+  fp.add(global_mesh_primitives.size());
+  for(auto &[mesh, mat, tr] : global_mesh_primitives) {
+    auto [it, first] = seen.emplace(mesh.get(), seen.size());
+    fp.add(it->second);
+    if(first) add_mesh(fp, *mesh);
+    add_placement(mat, tr);
+  }
+  fp.add(global_lazy_meshes.size());
+  for(auto &[mesh_ps, box, mat, tr] : global_lazy_meshes) {
+    add_to(fp, mesh_ps);
+    // The mesh is only read during the render, so the file stands for its contents.
+    fp.add(file_stamp(retrieve(mesh_ps, "filename", string())));
+    fp.add(box);
+    add_placement(mat, tr);
+  }
 
-  std::unique_ptr<Scene> the_scene;
-  std::unique_ptr<Integrator> the_integrator;
+  fp.add(lights.size());
+  for(const ParamSet &light_ps : lights) add_to(fp, light_ps);
+
+  // The placements above say which material each primitive has; the table says what they are.
+  MaterialTable table{ materials };
+  fp.add(table.size());
+  for(size_t id = 0; id <= table.size(); ++id) {
+    fp.add(table.blinn_phong(id));
+    fp.add(table.flat(id));
+  }
+  return fp.value();
+}
+
+std::unique_ptr<SceneBuild> API::build_scene(const SceneBuild *previous) {
+  auto build = std::make_unique<SceneBuild>();
 
   // MAKING THE SCENE
   std::unique_ptr<Background> the_background{ make_background(render_opt->bkg_type,
@@ -248,7 +463,54 @@ void API::world_end() {
 
     primitives.push_back(shared_ptr<PrimitiveBounds>(make_geometric_primitive(std::move(shape), mat)));
   }
+  // With a memory cap the meshes are clustered and paged in from disk; see GeometryCache.
+  shared_ptr<GeometryCache> &geometry_cache = build->geometry_cache;
+  if(curr_run_opt.max_geometry_mem > 0 and not global_mesh_primitives.empty()) {
+    geometry_cache = make_shared<GeometryCache>(curr_run_opt.max_geometry_mem);
+  }
+  // In a resident process every mesh gets an accelerator of its own, kept from build to build:
+  // a mesh that was neither edited, moved nor given another material is not built again.
+  bool mesh_subtrees = curr_run_opt.resident and not geometry_cache;
+  size_t n_reused = 0;
   for(auto [mesh_ps, mat, tr] : global_mesh_primitives) {
+    if(mesh_subtrees) {
+      Fingerprint key;
+      add_mesh(key, *mesh_ps);
+      key.add(mat ? mat->id : 0);
+      key.add(tr->m);
+      add_to(key, render_opt->accelerator_ps);
+
+      shared_ptr<PrimitiveBounds> &subtree = build->mesh_subtrees[key.value()].accelerator;
+      if(not subtree and previous and previous->mesh_subtrees.count(key.value())) {
+        subtree = previous->mesh_subtrees.at(key.value()).accelerator;
+        ++n_reused;
+      }
+      if(not subtree) {
+        shared_ptr<TriangleMesh> mesh_copy = mesh_ps->copy_mesh();
+        mesh_copy->apply_transform(tr);
+        vector<shared_ptr<PrimitiveBounds>> mesh_prims;
+        for(Shape* shape : make_triangles(mesh_copy)) {
+          mesh_prims.push_back(shared_ptr<PrimitiveBounds>(make_geometric_primitive(unique_ptr<Shape>(shape), mat)));
+        }
+        if(mesh_prims.empty()) {
+          build->mesh_subtrees.erase(key.value());
+          continue;
+        }
+        subtree = std::dynamic_pointer_cast<PrimitiveBounds>(make_primitive(render_opt->accelerator_ps,
+                                                                            std::move(mesh_prims)));
+      }
+      world_box = Bounds3f::insert(world_box, subtree->getBoundBox());
+      primitives.push_back(subtree);
+      continue;
+    }
+
+    if(geometry_cache) {
+      for(auto &cluster : geometry_cache->add_mesh(*mesh_ps, *tr, mat)) {
+        world_box = Bounds3f::insert(world_box, cluster->getBoundBox());
+        primitives.push_back(cluster);
+      }
+      continue;
+    }
     shared_ptr<TriangleMesh> mesh_copy = mesh_ps->copy_mesh();
     
     mesh_copy->apply_transform(tr);
@@ -259,7 +521,60 @@ void API::world_end() {
       primitives.push_back(shared_ptr<PrimitiveBounds>(make_geometric_primitive(std::move(unique_ptr<Shape>(shape)), mat)));
     }
   }
+  if(geometry_cache and not geometry_cache->finalize()) {
+    RT3_ERROR("Could not write or map the geometry cache file; is there room left in /tmp?");
+  }
+  if(mesh_subtrees) {
+    size_t n_used = build->mesh_subtrees.size();
+    if(previous) {
+      RT3_MESSAGE("    Mesh accelerators reused: " + std::to_string(n_reused) + " of " + std::to_string(n_used) + "\n");
+      // Those of the meshes that are gone stay for a few builds, for a process that goes back and forth
+      // between scenes (rt3d).
+      for(auto &[key, subtree] : previous->mesh_subtrees) {
+        if(subtree.idle < SceneBuild::MAX_IDLE_BUILDS and build->mesh_subtrees.count(key) == 0) {
+          build->mesh_subtrees[key] = SceneBuild::MeshSubtree{ subtree.accelerator, subtree.idle + 1 };
+        }
+      }
+    }
+    job_stats.mesh_accelerators += n_used;
+    job_stats.mesh_accelerators_reused += n_reused;
+  }
 
+  // Proxies only know their bounds; the mesh and its accelerator are built when a ray first reaches them.
+  vector<shared_ptr<LazyPrimitive>> &proxies = build->proxies;
+  ParamSet accelerator_ps = render_opt->accelerator_ps;
+  for(auto &lazy_mesh : global_lazy_meshes) {
+    const ParamSet &mesh_ps = std::get<0>(lazy_mesh);
+    shared_ptr<Material> mat = std::get<2>(lazy_mesh);
+    shared_ptr<Transform> tr = std::get<3>(lazy_mesh);
+
+    Bounds3f box = tr->apply_b(std::get<1>(lazy_mesh));
+    world_box = Bounds3f::insert(world_box, box);
+
+    auto proxy = make_shared<LazyPrimitive>(box, [mesh_ps, mat, tr, accelerator_ps]() {
+      shared_ptr<TriangleMesh> mesh;
+      {
+        std::lock_guard<std::mutex> lock{meshes_mutex};
+        mesh = try_load_mesh(mesh_ps);
+      }
+      // A mesh that can't be loaded is left out of the frame; the render goes on.
+      if(not mesh) return shared_ptr<Primitive>();
+      shared_ptr<TriangleMesh> mesh_copy = mesh->copy_mesh();
+      mesh_copy->apply_transform(tr);
+
+      vector<shared_ptr<PrimitiveBounds>> mesh_prims;
+      for(Shape* shape : make_triangles(mesh_copy)) {
+        mesh_prims.push_back(shared_ptr<PrimitiveBounds>(make_geometric_primitive(unique_ptr<Shape>(shape), mat)));
+      }
+      if(mesh_prims.empty()) {
+        RT3_WARNING("Lazy mesh \"" + retrieve(mesh_ps, "filename", string()) + "\" has no triangles; it is left out.");
+        return shared_ptr<Primitive>();
+      }
+      return make_primitive(accelerator_ps, std::move(mesh_prims));
+    });
+    proxies.push_back(proxy);
+    primitives.push_back(proxy);
+  }
 
   //unique_ptr<PrimList> primitive = unique_ptr<PrimList>(new PrimList(std::move(primitives)));
   shared_ptr<Primitive> primitive = make_primitive(render_opt->accelerator_ps, std::move(primitives));
@@ -269,34 +584,94 @@ void API::world_end() {
     the_lights.push_back(shared_ptr<Light>(make_light(light_ps, world_box)));
   }  
   
-  the_scene = make_unique<Scene>(std::move(primitive), std::move(the_background), std::move(the_lights));
-  // MADE THE SCENE
-
-  // MAKE THE INTEGRATOR -----------------------------------------------------------------------------------
-  std::unique_ptr<Film> the_film{ 
-                  make_film(render_opt->film_type, 
-                            render_opt->film_ps) };
+  build->scene = make_unique<Scene>(std::move(primitive), std::move(the_background), std::move(the_lights),
+                                 MaterialTable{ materials });
+  return build;
+}
 
-  std::unique_ptr<Camera> the_camera{ 
-                  make_camera(render_opt->camera_ps, 
-                              render_opt->lookat_ps, 
-                              std::move(the_film)) };
+void API::world_end() {
+  VERIFY_WORLD_BLOCK("API::world_end");
+  // The scene has been properly set up and the scene has
+  // already been parsed. It's time to render the scene.
 
-  the_integrator = unique_ptr<Integrator>(make_integrator(render_opt->integrator_ps, std::move(the_camera)));
-  // MADE THE INTEGRATOR -----------------------------------------------------------------------------------
+  auto build_start = std::chrono::steady_clock::now();
+  std::unique_ptr<Integrator> the_integrator;
 
-  // Run only if we got film and background.
-  if (the_integrator and the_scene) {
-    RT3_MESSAGE("    Parsing scene successfuly done!\n");
-    RT3_MESSAGE("[2] Starting ray tracing progress.\n");
+  // With render_again, or a new lookat, the world is often just what it was: its scene is kept,
+  // and only the film, the camera and the integrator are made again.
+  uint64_t fingerprint = world_fingerprint();
+  if (last_build and last_build->fingerprint == fingerprint) {
+    RT3_MESSAGE("    The world is unchanged since the last world_end; reusing its scene.\n");
+    ++job_stats.scenes_reused;
+  } else {
+    // In a resident process the new scene takes the unchanged meshes' accelerators from the last one;
+    // otherwise the last one goes before the new one is made, so that both are never in memory.
+    std::unique_ptr<SceneBuild> previous = std::move(last_build);
+    if (not curr_run_opt.resident) {
+      previous.reset();
+    }
+    last_build = build_scene(previous.get());
+    last_build->fingerprint = fingerprint;
+    ++job_stats.scenes_built;
+  }
+  const std::unique_ptr<Scene> &the_scene = last_build->scene;
+  const shared_ptr<GeometryCache> &geometry_cache = last_build->geometry_cache;
+  const vector<shared_ptr<LazyPrimitive>> &proxies = last_build->proxies;
+  // MADE THE SCENE
+  auto build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - build_start).count();
+  job_stats.build_ms += build_ms;
+
+  // A camera path renders a sequence of frames. The scene and its accelerator are built once;
+  // only the film, the camera and the integrator are made again for every frame.
+  const ParamSet &path_ps = render_opt->camera_path_ps;
+  bool animation = not path_ps.empty();
+  int n_frames = 1;
+  if (animation) {
+    n_frames = retrieve(path_ps, "frames", int(retrieve(path_ps, "look_from", vector<Point3f>{}).size()));
+    if (curr_run_opt.n_frames > 0) {
+      n_frames = curr_run_opt.n_frames;
+    }
+  } else if (curr_run_opt.n_frames > 0) {
+    RT3_WARNING("--frames needs a camera_path in the scene; rendering a single frame.");
+  }
 
-    // Structure biding, c++17.
-    /*auto res = the_camera->film->get_resolution();
-    size_t w = res[0];
-    size_t h = res[1];
-    RT3_MESSAGE("    Image dimensions in pixels (W x H): " + std::to_string(w) + " x "
-                + std::to_string(h) + ".\n");*/
-    RT3_MESSAGE("    Ray tracing is usually a slow process, please be patient: \n");
+  vector<double> frame_ms;
+  for (int frame = 0; frame < n_frames; ++frame) {
+    ParamSet lookat_ps = animation ? frame_lookat(path_ps, render_opt->lookat_ps, frame, n_frames)
+                                   : render_opt->lookat_ps;
+
+    // MAKE THE INTEGRATOR -----------------------------------------------------------------------------------
+    std::unique_ptr<Film> the_film{ 
+                    make_film(render_opt->film_type, 
+                              render_opt->film_ps,
+                              animation ? frame : -1) };
+
+    std::unique_ptr<Camera> the_camera{ 
+                    make_camera(render_opt->camera_ps, 
+                                lookat_ps, 
+                                std::move(the_film)) };
+
+    the_integrator = unique_ptr<Integrator>(make_integrator(render_opt->integrator_ps, std::move(the_camera)));
+    // MADE THE INTEGRATOR -----------------------------------------------------------------------------------
+
+    // Run only if we got film and background.
+    if (not the_integrator or not the_scene) break;
+
+    if (frame == 0) {
+      RT3_MESSAGE("    Parsing scene successfuly done!\n");
+      RT3_MESSAGE("[2] Starting ray tracing progress.\n");
+
+      // Structure biding, c++17.
+      /*auto res = the_camera->film->get_resolution();
+      size_t w = res[0];
+      size_t h = res[1];
+      RT3_MESSAGE("    Image dimensions in pixels (W x H): " + std::to_string(w) + " x "
+                  + std::to_string(h) + ".\n");*/
+      RT3_MESSAGE("    Ray tracing is usually a slow process, please be patient: \n");
+    }
+    if (animation) {
+      RT3_MESSAGE("    Frame " + std::to_string(frame + 1) + " of " + std::to_string(n_frames) + "\n");
+    }
 
     //================================================================================
     auto start = std::chrono::steady_clock::now();
@@ -309,15 +684,69 @@ void API::world_end() {
     auto diff = end - start;  // Store the time difference between start and end
     // Seconds
     auto diff_sec = std::chrono::duration_cast<std::chrono::seconds>(diff);
+    frame_ms.push_back(std::chrono::duration<double, std::milli>(diff).count());
+    job_stats.render_ms += frame_ms.back();
     RT3_MESSAGE("    Time elapsed: " + std::to_string(diff_sec.count()) + " seconds ("
-                + std::to_string(std::chrono::duration<double, std::milli>(diff).count())
+                + std::to_string(frame_ms.back())
                 + " ms) \n");
   }
+
+  if (not frame_ms.empty()) {
+    if (animation) {
+      double total = std::accumulate(frame_ms.begin(), frame_ms.end(), 0.0);
+      auto [fastest, slowest] = std::minmax_element(frame_ms.begin(), frame_ms.end());
+      RT3_MESSAGE("    " + std::to_string(frame_ms.size()) + " frames in " + std::to_string(total) + " ms: "
+                  + std::to_string(total / frame_ms.size()) + " ms per frame on average, fastest "
+                  + std::to_string(*fastest) + " ms, slowest " + std::to_string(*slowest) + " ms; scene built once in "
+                  + std::to_string(build_ms) + " ms\n");
+    }
+
+    if(geometry_cache) {
+      auto stats = geometry_cache->stats();
+      RT3_MESSAGE("    Geometry cache: " + std::to_string(stats.n_clusters) + " clusters, "
+                  + std::to_string(stats.page_ins) + " page-ins, "
+                  + std::to_string(stats.evictions) + " evictions, "
+                  + std::to_string(stats.stall_ms) + " ms stalled, peak "
+                  + std::to_string(stats.peak_bytes / (1024 * 1024)) + " of "
+                  + std::to_string(curr_run_opt.max_geometry_mem / (1024 * 1024)) + " MB\n");
+    }
+
+    if(not proxies.empty()) {
+      auto loaded = std::count_if(proxies.begin(), proxies.end(), [](auto &p) { return p->is_loaded(); });
+      RT3_MESSAGE("    Lazy meshes loaded: " + std::to_string(loaded) + " of "
+                  + std::to_string(proxies.size()) + "\n");
+    }
+  }
+  if(curr_run_opt.resident) {
+    age_meshes();
+  }
   // [4] Basic clean up
   curr_state = APIState::SetupBlock;  // correct machine state.
   reset_engine();
 }
 
+void API::age_meshes() {
+  std::set<const TriangleMesh*> used;
+  for(auto &[mesh, mat, tr] : global_mesh_primitives) used.insert(mesh.get());
+  std::set<string> used_lazy;
+  for(auto &lazy_mesh : global_lazy_meshes) used_lazy.insert(retrieve(std::get<0>(lazy_mesh), "filename", string()));
+
+  std::map<string, int> idle;
+  for(auto it = meshes.begin(); it != meshes.end();) {
+    auto seen = mesh_idle.find(it->first);
+    int n = (used.count(it->second.get()) or used_lazy.count(it->first)) ? 0
+          : (seen != mesh_idle.end() ? seen->second : 0) + 1;
+    if(n > SceneBuild::MAX_IDLE_BUILDS) {
+      RT3_MESSAGE("    \"" + it->first + "\" was not used by the last " + std::to_string(n) + " scenes; dropping it.\n");
+      it = meshes.erase(it);
+    } else {
+      idle[it->first] = n;
+      ++it;
+    }
+  }
+  mesh_idle.swap(idle);
+}
+
 /// This api function is called when we need to re-render the *same* scene (i.e.
 /// objects, lights, materials, etc) , maybe with different integrator, and
 /// camera setup. Hard reset on the engine. User needs to setup all entities,
@@ -367,6 +796,29 @@ void API::lookat(const ParamSet& ps) {
   render_opt->lookat_ps = ps;
 }
 
+void API::camera_path(const ParamSet& ps) {
+  std::cout << ">>> Inside API::camera_path()\n";
+  VERIFY_SETUP_BLOCK("API::camera_path");
+
+  if (not ps.count("look_from")) {
+    RT3_ERROR("camera_path needs at least one look_from keyframe.");
+  }
+  size_t n_keys = retrieve(ps, "look_from", vector<Point3f>{}).size();
+  if (n_keys == 0) {
+    RT3_ERROR("camera_path needs at least one look_from keyframe.");
+  }
+  if (ps.count("frames") and retrieve(ps, "frames", 1) < 1) {
+    RT3_ERROR("camera_path: frames must be at least 1.");
+  }
+  for (const string key : { "look_at", "up" }) {
+    size_t n = retrieve(ps, key, vector<Vector3f>{ Vector3f{} }).size();
+    if (n != 1 and n != n_keys) {
+      RT3_ERROR("camera_path: " + key + " must have one value or as many as look_from.");
+    }
+  }
+  render_opt->camera_path_ps = ps;
+}
+
 void API::make_named_material(const ParamSet &ps) {
   std::cout << ">>> Inside API::make_named_material()\n";
   VERIFY_WORLD_BLOCK("API::make_named_material");
@@ -374,7 +826,7 @@ void API::make_named_material(const ParamSet &ps) {
 
   string material_name = retrieve(ps, "name", string());
 
-  named_materials[material_name] = shared_ptr<Material>(make_material(ps));
+  named_materials[material_name] = make_material(ps);
 }
 
 void API::named_material(const ParamSet &ps) {
@@ -390,9 +842,7 @@ void API::material(const ParamSet &ps) {
   std::cout << ">>> Inside API::material()\n";
   VERIFY_WORLD_BLOCK("API::material");
 
-  std::shared_ptr<Material> new_material(make_material(ps));
-
-  curr_material = new_material;
+  curr_material = make_material(ps);
 }
 
 void API::integrator(const ParamSet &ps) {
@@ -418,25 +868,26 @@ void API::object(const ParamSet &ps) {
   if(type == "trianglemesh") {
     if(ps.count("filename")) {
       string filename = retrieve(ps, "filename", string());
-
-      if(meshes.count(filename) == 0) {
-        shared_ptr<TriangleMesh> tm{new TriangleMesh()};
-
-        bool status = load_mesh_data(
-          retrieve(ps, "filename", string{}), 
-          retrieve(ps, "reverse_vertex_order", false), 
-          retrieve(ps, "compute_normals", false),
-          retrieve(ps, "flip_normals", false), 
-          tm
-        );      
-
-        if(status){
-          tm->backface_cull = retrieve(ps, "backface_cull", false);
-        }else{
-          RT3_ERROR("Couldn't load obj file");
+      watched_files.insert(filename);
+
+      bool lazy = retrieve(ps, "lazy", string{"false"}) == "true";
+      Bounds3f box;
+      if(lazy and lazy_mesh_bounds(ps, filename, box)) {
+        if(curr_obj == "") {
+          global_lazy_meshes.push_back({ps, box, curr_material, make_shared<Transform>(curr_TM)});
+        } else {
+          named_obj_build[curr_obj]->lazy_meshes.push_back({ps, box, curr_material, make_shared<Transform>(curr_TM)});
         }
+        return;
+      }
 
-        meshes[filename] = tm;
+      load_mesh(ps);
+      if(lazy) {
+        // Without bounds the proxy can't be built; load it now and leave the bounds for the next run.
+        RT3_WARNING("No bounds for lazy mesh \"" + filename + "\"; loading it now.");
+        if(save_bounds_sidecar(filename, meshes[filename]->compute_bounds())) {
+          RT3_MESSAGE("    Wrote " + filename + ".bounds\n");
+        }
       }
 
       if(curr_obj == "") {
@@ -495,6 +946,10 @@ void API::instantiate_obj(const ParamSet &ps) {
     global_mesh_primitives.push_back({mesh, mat, make_shared<Transform>((*tr).update(curr_TM))}); 
   }
 
+  for(auto [ps, box, mat, tr] : named_obj_build[obj_name]->lazy_meshes) {
+    global_lazy_meshes.push_back({ps, box, mat, make_shared<Transform>((*tr).update(curr_TM))});
+  }
+
   for(auto ps : named_obj_build[obj_name]->lights) {
     lights.push_back(ps);
   }
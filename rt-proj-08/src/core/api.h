@@ -1,6 +1,7 @@
 #ifndef API_H
 #define API_H 1
 
+#include <set>
 #include <string>
 
 #include "paramset.h"
@@ -74,6 +75,9 @@ struct RenderOptions {
   
   /// the Look At
   ParamSet lookat_ps;
+
+  /// the Camera Path, for animations; empty for a single frame.
+  ParamSet camera_path_ps;
   
   /// the Bakcground
   string bkg_type{"solid"}; // "image", "interpolated"
@@ -89,10 +93,41 @@ struct RenderOptions {
 struct ObjectBuild {
   vector<tuple<ParamSet, shared_ptr<Material>, shared_ptr<Transform>>> primitives;
   vector<tuple<shared_ptr<TriangleMesh>, shared_ptr<Material>, shared_ptr<Transform>>> mesh_primitives;
+  vector<tuple<ParamSet, Bounds3f, shared_ptr<Material>, shared_ptr<Transform>>> lazy_meshes;
 
   vector<ParamSet> lights;
 };
 
+class GeometryCache;
+
+/// A scene made by `API::world_end()`, kept so that the next `world_end()` can reuse it.
+struct SceneBuild {
+  /// In a long-lived process, what a build no longer uses (a mesh's accelerator, a mesh read)
+  /// is kept for this many builds in a row, for jobs that go back and forth between scenes.
+  static constexpr int MAX_IDLE_BUILDS = 4;
+
+  uint64_t fingerprint;  //!< Of the world the scene was made from; see API::world_fingerprint().
+  unique_ptr<Scene> scene;
+  shared_ptr<GeometryCache> geometry_cache;  //!< Pages the meshes in, with `--max-geometry-mem`.
+  vector<shared_ptr<LazyPrimitive>> proxies; //!< Of the lazy meshes.
+  /// An accelerator over a single mesh, kept for the next builds of a long-lived process.
+  struct MeshSubtree {
+    shared_ptr<PrimitiveBounds> accelerator;
+    int idle = 0;  //!< # of builds in a row that did not use it.
+  };
+  /// With `RunningOptions::resident`: the accelerator of every mesh, by the fingerprint of the mesh,
+  /// its placement and the accelerator parameters, for the next builds to take the unchanged ones from.
+  std::map<uint64_t, MeshSubtree> mesh_subtrees;
+};
+
+/// What the engine did since `API::init_engine()`, for a process that reports on its jobs (rt3d).
+struct JobStats {
+  double build_ms = 0;   //!< Making scenes, in world_end(); parsing and loading the meshes come before.
+  double render_ms = 0;  //!< Rendering every frame.
+  int scenes_built = 0, scenes_reused = 0;
+  size_t mesh_accelerators = 0, mesh_accelerators_reused = 0;
+};
+
 /// Static class that manages the render process
 class API {
 public:
@@ -107,10 +142,17 @@ public:
   static RunningOptions curr_run_opt;
   static vector<tuple<ParamSet, shared_ptr<Material>, shared_ptr<Transform>>> global_primitives;
   static vector<tuple<shared_ptr<TriangleMesh>, shared_ptr<Material>, shared_ptr<Transform>>> global_mesh_primitives;
+  /// Meshes loaded on demand: object params, object space bounds, material and transform.
+  static vector<tuple<ParamSet, Bounds3f, shared_ptr<Material>, shared_ptr<Transform>>> global_lazy_meshes;
   static shared_ptr<Material> curr_material;
   static std::map<string, shared_ptr<Material>> named_materials;
+  /// Every material made so far; the k-th has id k + 1.
+  static vector<shared_ptr<Material>> materials;
   static std::map<string, shared_ptr<TriangleMesh>> meshes;
   static vector<ParamSet> lights;
+  /// Scene files parsed and mesh files named so far; `--watch` renders again when one changes.
+  static std::set<string> watched_files;
+  static JobStats job_stats;
 
   static Transform curr_TM;
   static std::stack<shared_ptr<Transform>> saved_TM;
@@ -134,6 +176,10 @@ private:
    */
   /// Unique infrastructure to render a scene (camera, integrator, etc.).
   static std::unique_ptr<RenderOptions> render_opt;
+  /// The scene of the last `world_end()`; null before the first one.
+  static std::unique_ptr<SceneBuild> last_build;
+  /// # of `world_end()`s in a row whose world did not use each mesh of `meshes`, by file name.
+  static std::map<string, int> mesh_idle;
   // [NO NECESSARY IN THIS PROJECT]
   // /// The current GraphicsState
   // static GraphicsState curr_GS;
@@ -144,26 +190,53 @@ private:
 
   // === Helper functions.
   ///
-  static Film *make_film(const string &name, const ParamSet &ps);
+  static Film *make_film(const string &name, const ParamSet &ps, int frame = -1);
   static Background *make_background(const string &name, const ParamSet &ps);
   static Camera *make_camera(const ParamSet &ps_camera, const ParamSet &ps_lookat, unique_ptr<Film> &&the_film);
-  static Material *make_material( const ParamSet &ps_material);
+  static shared_ptr<Material> make_material( const ParamSet &ps_material);
   static Integrator *make_integrator(const ParamSet &ps_integrator, unique_ptr<Camera> &&camera);
   static Shape *make_shape(const ParamSet &ps, shared_ptr<Transform> tr);
   static GeometricPrimitive *make_geometric_primitive(unique_ptr<Shape> &&shape, shared_ptr<Material> material);
   static Light * make_light( const ParamSet &ps_light, Bounds3f worldBox);
   static vector<Shape*> make_triangles(shared_ptr<TriangleMesh> tm);
+  static shared_ptr<TriangleMesh> load_mesh(const ParamSet &ps);
+  /// Like load_mesh(), but warns and returns null when the file can't be read, for the lazy
+  /// meshes: they are loaded by the render threads, which must not stop the program.
+  static shared_ptr<TriangleMesh> try_load_mesh(const ParamSet &ps);
   static shared_ptr<Primitive> make_primitive( const ParamSet& ps_accelerator, vector<shared_ptr<PrimitiveBounds>>&& primitives);
+  /// Hash of everything the scene is made from: the primitives and meshes with their materials
+  /// and transforms, the materials, the lights, the background and the accelerator.
+  /// A world with the same fingerprint as the last one gets its scene back.
+  static uint64_t world_fingerprint();
+  /// In a long-lived process, drops from `meshes` those the current world does not use and the
+  /// last `SceneBuild::MAX_IDLE_BUILDS` worlds did not either.
+  static void age_meshes();
+  /// Makes the primitives, the accelerator and the lights of the current world. In a resident
+  /// process, the accelerators of the meshes that did not change are taken from `previous`, if given.
+  static std::unique_ptr<SceneBuild> build_scene(const SceneBuild *previous);
+  /// Forgets the scene description, so that the scene files can be parsed again. What was read
+  /// from disk (`meshes`) and the last scene (`last_build`) are kept, to be reused.
+  static void reset_world();
 public:
   //=== API function begins here.
+  /// Starts a job: init_engine(), run(), clean_up(). A long-lived process may run several; each
+  /// starts from an empty world, but the meshes read and the last scene are kept from job to job.
   static void init_engine(const RunningOptions &);
   static void run();
+  /// After an exception escaped run() (an RT3Error, see throw_on_error(), or one a render thread
+  /// threw), drops the half-made world and goes
+  /// back to before init_engine(). The meshes and the last scene are kept.
+  static void abort_job();
+  /// `--watch`: runs the scene, then runs it again whenever one of `watched_files` changes,
+  /// until the process is killed.
+  static void watch();
   static void clean_up();
   static void reset_engine();
 
   static void film(const ParamSet &ps);
   static void camera(const ParamSet &ps);
   static void lookat(const ParamSet &ps);
+  static void camera_path(const ParamSet &ps);
   static void background(const ParamSet &ps);
   static void world_begin();
   static void world_end();
@@ -2,12 +2,12 @@
 
 namespace rt3 {
 
-std::pair<real_type, real_type> Camera::get_uv(int i, int j) {
-    real_type u = sw.width() * (j + 0.5);
+std::pair<real_type, real_type> Camera::get_uv(int i, int j, Point2f offset) {
+    real_type u = sw.width() * (j + double(offset.x));
     u /= film->width();
     u += sw.l;
 
-    real_type v = sw.height() * (i + 0.5);
+    real_type v = sw.height() * (i + double(offset.y));
     v /= film->height();
     v += sw.b;
     
@@ -15,9 +15,13 @@ public:
 
     Camera(std::unique_ptr<Film> &&film, Point3f lf, Point3f la, Vector3f up, ScreenWindow sw);
 
-    std::pair<real_type, real_type> get_uv(int i, int j);
+    /// Screen coordinates of the point `offset` (in [0,1)^2) inside pixel (i, j).
+    std::pair<real_type, real_type> get_uv(int i, int j, Point2f offset = Point2f{0.5f, 0.5f});
 
-    virtual Ray generate_ray(int x, int y) = 0;
+    /// Ray through the point `offset` (in [0,1)^2) inside pixel (x, y).
+    virtual Ray generate_ray(int x, int y, Point2f offset) = 0;
+    /// Ray through the center of pixel (x, y).
+    Ray generate_ray(int x, int y) { return generate_ray(x, y, Point2f{0.5f, 0.5f}); }
 };
 
 }
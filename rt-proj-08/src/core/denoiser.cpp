@@ -0,0 +1,108 @@
+#include "denoiser.h"
+
+#include <chrono>
+#include <cmath>
+
+#include "thread_pool.h"
+
+namespace rt3 {
+
+namespace {
+
+constexpr int RADIUS = 5;                     //!< The filter covers (2 RADIUS + 1)^2 pixels.
+constexpr real_type SIGMA_SPATIAL = 3;        //!< In pixels.
+constexpr real_type SIGMA_NORMAL = 0.2;       //!< Of the distance between unit normals.
+constexpr real_type SIGMA_ALBEDO = 0.05;
+constexpr real_type SIGMA_DEPTH = 0.02;       //!< Relative to the pixel's depth.
+constexpr real_type SIGMA_COLOR = 0.3;        //!< For pixels without a noise estimate.
+constexpr real_type NOISE_SCALE = 8;          //!< Color range, in variances of the two pixels' means.
+
+/// The guides of a pixel, averaged over its samples.
+struct Guide {
+    Vector3f normal{0, 0, 0};
+    Vector3f albedo{0, 0, 0};
+    real_type depth = 0;
+    real_type variance = -1; //!< Of the pixel's mean; -1 if unknown.
+};
+
+real_type dist2(const Vector3f &a, const Vector3f &b) {
+    Vector3f d = a - b;
+    return glm::dot(d, d);
+}
+
+}
+
+std::unique_ptr<Film::ColorBuffer> denoise( const Film &film, int n_threads ) {
+    auto start = std::chrono::steady_clock::now();
+    const Film::ColorBuffer &image = *film.m_color_buffer_ptr;
+    auto result = std::make_unique<Film::ColorBuffer>(image);
+    const Film::PixelWindow &crop = film.m_crop;
+    int w = film.width();
+
+    vector<Guide> guides(film.m_guides.size());
+    for(int i = crop.i0; i < crop.i1; i++) {
+        for(int j = crop.j0; j < crop.j1; j++) {
+            const Film::PixelGuide &sums = film.m_guides[i * w + j];
+            Guide &g = guides[i * w + j];
+            if(sums.count == 0) continue;
+            g.normal = Vector3f{ sums.normal[0], sums.normal[1], sums.normal[2] };
+            if(glm::dot(g.normal, g.normal) > 0) g.normal = glm::normalize(g.normal);
+            g.albedo = Vector3f{ sums.albedo[0], sums.albedo[1], sums.albedo[2] } / real_type(sums.count);
+            g.depth = sums.depth / sums.count;
+            if(film.sample_count(Point2i{ i, j }) > 1) g.variance = film.variance(Point2i{ i, j });
+        }
+    }
+
+    real_type spatial[2 * RADIUS + 1];
+    for(int d = -RADIUS; d <= RADIUS; ++d) {
+        spatial[d + RADIUS] = std::exp(-d * d / (2 * SIGMA_SPATIAL * SIGMA_SPATIAL));
+    }
+
+    // A row per task; the filter only reads `image`, so the rows are independent.
+    WorkStealingPool pool{ n_threads };
+    pool.run(crop.height(), [&](size_t row, int) {
+        int i = crop.i0 + row;
+        for(int j = crop.j0; j < crop.j1; j++) {
+            const Guide &p = guides[i * w + j];
+            const Color &cp = image.mat[i][j];
+            real_type sum[3] = {0, 0, 0};
+            real_type total = 0;
+
+            for(int qi = std::max(crop.i0, i - RADIUS); qi < std::min(crop.i1, i + RADIUS + 1); qi++) {
+                for(int qj = std::max(crop.j0, j - RADIUS); qj < std::min(crop.j1, j + RADIUS + 1); qj++) {
+                    const Guide &q = guides[qi * w + qj];
+                    // The background and the scene are never mixed.
+                    if((p.depth > 0) != (q.depth > 0)) continue;
+
+                    const Color &cq = image.mat[qi][qj];
+                    real_type dc = (cp.r - cq.r) * (cp.r - cq.r) + (cp.g - cq.g) * (cp.g - cq.g) + (cp.b - cq.b) * (cp.b - cq.b);
+                    real_type sigma_c2 = (p.variance >= 0 && q.variance >= 0)
+                                       ? NOISE_SCALE * (p.variance + q.variance) + 1e-4f
+                                       : SIGMA_COLOR * SIGMA_COLOR;
+                    real_type exponent = dc / (2 * sigma_c2)
+                                       + dist2(p.normal, q.normal) / (2 * SIGMA_NORMAL * SIGMA_NORMAL)
+                                       + dist2(p.albedo, q.albedo) / (2 * SIGMA_ALBEDO * SIGMA_ALBEDO);
+                    if(p.depth > 0) {
+                        real_type dd = (p.depth - q.depth) / (SIGMA_DEPTH * p.depth);
+                        exponent += dd * dd / 2;
+                    }
+                    real_type weight = spatial[qi - i + RADIUS] * spatial[qj - j + RADIUS] * std::exp(-exponent);
+
+                    sum[0] += weight * cq.r;
+                    sum[1] += weight * cq.g;
+                    sum[2] += weight * cq.b;
+                    total += weight;
+                }
+            }
+            // The pixel itself always has weight 1, so `total` is never 0.
+            result->mat[i][j] = Color{ sum[0] / total, sum[1] / total, sum[2] / total };
+        }
+    });
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "\t Denoised " << crop.height() * crop.width() << " pixels on " << pool.size() << " threads in "
+              << ms << " ms.\n";
+    return result;
+}
+
+}
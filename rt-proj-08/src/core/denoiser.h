@@ -0,0 +1,25 @@
+#ifndef DENOISER_H
+#define DENOISER_H
+
+#include "film.h"
+
+namespace rt3 {
+
+/*!
+ * Joint bilateral filter of the film's image, guided by its guide buffers (`Film::m_guides`).
+ *
+ * Each pixel of the crop window becomes a weighted mean of its neighbours. A neighbour's weight
+ * falls with its distance in the image and with how much its normal, albedo and depth differ,
+ * so the filter stops at silhouettes, creases and material boundaries. Its color counts too,
+ * measured against the noise both pixels are estimated to have (`Film::variance()`): pixels
+ * whose samples agree are barely blurred. Pixels with a single sample have no noise estimate
+ * and are filtered with a fixed color range.
+ *
+ * \param n_threads # of threads to filter with; 0 means one per hardware thread.
+ * \return A copy of the image with the crop window filtered.
+ */
+std::unique_ptr<Film::ColorBuffer> denoise( const Film &film, int n_threads );
+
+}
+
+#endif
@@ -1,5 +1,6 @@
 #include "error.h"
 
+#include <atomic>
 #include <cstdlib>  // std::exit
 #include <sstream>
 
@@ -10,6 +11,10 @@ inline std::ostream& operator<<(std::ostream& os, const rt3::SourceContext& sc)
 
 namespace rt3 {
 
+// For the whole process: an error in a render thread goes through WorkStealingPool::run() to the
+// thread that started the render.
+static std::atomic<bool> errors_throw{ false };
+
 /// Prints out the warning, but the program keeps running.
 void Warning(const std::string& msg, const SourceContext& sc) {
   std::cerr << std::setw(80) << std::setfill('=') << " " << '\n'
@@ -23,11 +28,16 @@ void Error(const std::string& msg, const SourceContext& sc) {
   std::cerr << std::setw(80) << std::setfill('=') << " " << '\n'
             << "[RT3 Communication System] Severe error: \"" << msg << "\"" << '\n'
             << "     REPORTED AT: < " << sc << " > " << '\n'
-            << "     exiting...\n"
+            << (errors_throw ? "     aborting...\n" : "     exiting...\n")
             << std::setw(80) << std::setfill('=') << " " << '\n';
 
+  if (errors_throw) {
+    throw RT3Error(msg);
+  }
   std::exit(EXIT_FAILURE);
 }
 
+void throw_on_error(bool enable) { errors_throw = enable; }
+
 void Message(const std::string& str) { std::cout << str << '\n'; }
 }  // namespace rt3
@@ -3,6 +3,7 @@
 
 # include <iomanip>  // setw()
 # include <iostream>
+# include <stdexcept>
 # include <string>
 
 # define SC               SourceContext(__FILE__, __LINE__)
@@ -25,8 +26,17 @@ struct SourceContext {
   ~SourceContext() = default;
 };
 
+/// What Error() throws, instead of exiting, after throw_on_error(true).
+struct RT3Error : public std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
 /// Prints out the error message and exits the program.
 void Error(const std::string&, const SourceContext&);
+/// Makes Error() throw an RT3Error rather than exit, so that a process that stays resident
+/// (`--watch`, rt3d) survives a broken scene file. It holds for every thread: an error in a
+/// render thread reaches the caller of WorkStealingPool::run().
+void throw_on_error(bool);
 /// Prints out the warning, but the program keeps running.
 void Warning(const std::string&, const SourceContext&);
 /// Prints out a simple message, program keeps running.
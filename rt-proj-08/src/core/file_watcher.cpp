@@ -0,0 +1,66 @@
+#include "file_watcher.h"
+
+#include <climits>
+#include <cstdlib>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "error.h"
+
+namespace rt3 {
+
+FileWatcher::FileWatcher() : m_fd(inotify_init1(IN_CLOEXEC)) {
+    if(m_fd < 0) RT3_ERROR("Could not start watching files (inotify_init1 failed).");
+}
+
+FileWatcher::~FileWatcher() {
+    ::close(m_fd);
+}
+
+std::string FileWatcher::absolute_path( const std::string &filename ) {
+    char path[PATH_MAX];
+    return realpath(filename.c_str(), path) ? std::string(path) : std::string();
+}
+
+bool FileWatcher::watch( const std::string &filename ) {
+    std::string path = absolute_path(filename);
+    if(path.empty()) return false;
+
+    std::string dir = path.substr(0, path.rfind('/'));
+    if(dir.empty()) dir = "/";
+    // Adding a directory twice gives back its descriptor.
+    int wd = inotify_add_watch(m_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    if(wd < 0) return false;
+
+    m_dirs[wd] = dir;
+    m_files.insert(path);
+    return true;
+}
+
+void FileWatcher::read_events( std::set<std::string> &changed ) {
+    alignas(inotify_event) char buffer[4096];
+    ssize_t size = ::read(m_fd, buffer, sizeof(buffer));
+    for(ssize_t k = 0; k < size;) {
+        const auto *event = reinterpret_cast<const inotify_event*>(buffer + k);
+        k += sizeof(inotify_event) + event->len;
+        if(event->len == 0 || m_dirs.count(event->wd) == 0) continue;
+
+        const std::string &dir = m_dirs[event->wd];
+        std::string path = (dir == "/" ? "" : dir) + "/" + event->name;
+        if(m_files.count(path)) changed.insert(path);
+    }
+}
+
+std::vector<std::string> FileWatcher::wait( int quiet_ms ) {
+    std::set<std::string> changed;
+    pollfd pfd{ m_fd, POLLIN, 0 };
+    while(changed.empty()) {
+        if(poll(&pfd, 1, -1) > 0) read_events(changed);
+    }
+    while(poll(&pfd, 1, quiet_ms) > 0) read_events(changed);
+
+    return std::vector<std::string>(changed.begin(), changed.end());
+}
+
+} // namespace rt3
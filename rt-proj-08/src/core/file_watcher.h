@@ -0,0 +1,47 @@
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace rt3 {
+
+/*!
+ * Tells when files change on disk (Linux `inotify`), for `--watch`.
+ *
+ * The directories of the files are watched rather than the files themselves, so that
+ * editors that save by writing a new file and renaming it over the old one are caught too.
+ * Files are known by their absolute path.
+ */
+class FileWatcher {
+public:
+    FileWatcher();
+    ~FileWatcher();
+
+    FileWatcher( const FileWatcher& ) = delete;
+    FileWatcher& operator=( const FileWatcher& ) = delete;
+
+    /// Starts watching `filename`; returns false if it does not exist or can't be watched.
+    bool watch( const std::string &filename );
+
+    /// Blocks until some watched files are written, then waits for `quiet_ms` without changes
+    /// (a save often takes several writes) and returns the absolute paths of the changed files.
+    std::vector<std::string> wait( int quiet_ms = 100 );
+
+    /// Absolute path of `filename`, or an empty string if it does not exist.
+    static std::string absolute_path( const std::string &filename );
+
+private:
+    /// Reads the pending events, adds the watched files they name to `changed`.
+    void read_events( std::set<std::string> &changed );
+
+    int m_fd;                               //!< The inotify instance.
+    std::map<int, std::string> m_dirs;      //!< Watched directories, by watch descriptor.
+    std::set<std::string> m_files;          //!< Watched files.
+};
+
+} // namespace rt3
+
+#endif // FILE_WATCHER_H
@@ -2,14 +2,18 @@
 #include <cmath>
 
 #include "api.h"
+#include "denoiser.h"
 #include "image_io.h"
 #include "paramset.h"
+#include "partial_image.h"
 
 namespace rt3 {
 
 //=== Film Method Definitions
-Film::Film(const Point2i& resolution, const std::string& filename, image_type_e imgt)
-    : m_full_resolution{ resolution }, m_filename{ filename }, m_image_type{ imgt } {
+Film::Film(const Point2i& resolution, const std::string& filename, image_type_e imgt, const Sampling& sampling,
+           const PixelWindow& crop, bool write_cropped)
+    : m_full_resolution{ resolution }, m_filename{ filename }, m_image_type{ imgt }, m_sampling{ sampling },
+      m_crop{ crop }, m_write_cropped{ write_cropped }, m_stats(size_t(resolution.x) * resolution.y) {
   m_color_buffer_ptr = std::make_unique<ColorBuffer>(resolution.y, resolution.x);
 }
 
@@ -20,13 +24,77 @@ void Film::add_sample(const Point2i& pixel_coord, const Color& pixel_color) {
   /* std::cout << "Adding Sample: " << std::endl;
   std::cout << pixel_coord.x << " " << pixel_coord.y << ": " << std::endl; */
 
-  m_color_buffer_ptr->mat[pixel_coord.x][pixel_coord.y] = Color(pixel_color);
+  // Sums are kept apart from the image, since Color operations clamp.
+  PixelStats& stats = m_stats[pixel_coord.x * width() + pixel_coord.y];
+  Color c{ pixel_color };
+  for (int k = 0; k < 3; k++) {
+    stats.sum[k] += c[k];
+    stats.sum_sq[k] += c[k] * c[k];
+  }
+  stats.count++;
+
+  Color& mean = m_color_buffer_ptr->mat[pixel_coord.x][pixel_coord.y];
+  if (stats.count == 1) {
+    mean = c;
+  } else {
+    mean = Color{ stats.sum[0] / stats.count, stats.sum[1] / stats.count, stats.sum[2] / stats.count };
+  }
 
   /* std::cout << m_color_buffer_ptr->mat[pixel_coord.x][pixel_coord.y].r << " ";
   std::cout << m_color_buffer_ptr->mat[pixel_coord.x][pixel_coord.y].g << " ";
   std::cout << m_color_buffer_ptr->mat[pixel_coord.x][pixel_coord.y].b << std::endl; */
 }
 
+void Film::add_guide(const Point2i& pixel_coord, const Vector3f& normal, const Color& albedo, real_type depth) {
+  PixelGuide& guide = m_guides[pixel_coord.x * width() + pixel_coord.y];
+  Color a{ albedo };
+  for (int k = 0; k < 3; k++) {
+    guide.normal[k] += normal[k];
+    guide.albedo[k] += a[k];
+  }
+  guide.depth += depth;
+  guide.count++;
+}
+
+real_type Film::variance(const Point2i& p) const {
+  const PixelStats& stats = m_stats[p.x * width() + p.y];
+  int n = stats.count;
+  if (n < 2) return 0;
+
+  real_type var = 0;
+  for (int k = 0; k < 3; k++) {
+    real_type mean = stats.sum[k] / n;
+    // Sample variance, then divided by n for the variance of the mean.
+    real_type sample_var = std::max(real_type(0), (stats.sum_sq[k] - n * mean * mean) / (n - 1));
+    var = std::max(var, sample_var / n);
+  }
+  return var;
+}
+
+bool Film::needs_samples(const Point2i& p) const {
+  int n = sample_count(p);
+  if (n >= spp_limit()) return false;
+  if (m_preview_stride > 1
+      and ((p.x - m_crop.i0) % m_preview_stride != 0 or (p.y - m_crop.j0) % m_preview_stride != 0)) {
+    return false;
+  }
+  if (!m_sampling.adaptive || n < m_sampling.min_spp) return true;
+  return variance(p) > m_sampling.max_variance;
+}
+
+void Film::fill_preview() {
+  int s = m_preview_stride;
+  for (int i = m_crop.i0; i < m_crop.i1; i++) {
+    for (int j = m_crop.j0; j < m_crop.j1; j++) {
+      if (sample_count(Point2i{ i, j }) > 0) continue;
+      int ai = m_crop.i0 + (i - m_crop.i0) / s * s;
+      int aj = m_crop.j0 + (j - m_crop.j0) / s * s;
+      // Only the color: the first sample of the pixel replaces it.
+      m_color_buffer_ptr->mat[i][j] = m_color_buffer_ptr->mat[ai][aj];
+    }
+  }
+}
+
 /// Convert image to RGB, compute final pixel values, write image.
 void Film::write_image() const {
   // TODO: call the proper writing function, either PPM or PNG.
@@ -37,17 +105,35 @@ void Film::write_image() const {
     std::cout << i << " = " << (int) bytes[i] << std::endl;
   } */
 
+  if (not m_partial_filename.empty()) {
+    std::cout << "Saving " << m_tiles.size() << " tiles in " << m_partial_filename << std::endl;
+    if (not save_partial_image(m_partial_filename, *this, m_tile_size, m_tiles)) {
+      RT3_ERROR("Could not save the partial image.");
+    }
+    return;
+  }
+
+  // The samples are left as they are, so that a progressive render goes on adding to them.
+  ColorBuffer* image = m_color_buffer_ptr.get();
+  std::unique_ptr<ColorBuffer> denoised;
+  // Previews are written as they are; the guides only cover part of their pixels.
+  if (wants_guides() and m_preview_stride == 1) {
+    denoised = denoise(*this, API::curr_run_opt.n_threads);
+    image = denoised.get();
+  }
+
   std::cout << "Try to save file in " << m_filename << std::endl;
   
+  PixelWindow out = m_write_cropped ? m_crop : PixelWindow{ 0, height(), 0, width() };
   if(m_image_type == image_type_e::PNG) {
-    byte* bytes = m_color_buffer_ptr->get_byte_arr(4);
-    ok = save_png(bytes, width(), height(), 4, m_filename);
+    vector<byte> bytes = image->get_byte_arr(4, out.i0, out.i1, out.j0, out.j1);
+    ok = save_png(bytes.data(), out.width(), out.height(), 4, m_filename);
   } else if(m_image_type == image_type_e::PPM3) {
-    byte* bytes = m_color_buffer_ptr->get_byte_arr(3);
-    ok = save_ppm3(bytes, width(), height(), 3, m_filename);
+    vector<byte> bytes = image->get_byte_arr(3, out.i0, out.i1, out.j0, out.j1);
+    ok = save_ppm3(bytes.data(), out.width(), out.height(), 3, m_filename);
   } else if(m_image_type == image_type_e::PPM6) {
-    byte* bytes = m_color_buffer_ptr->get_byte_arr(3);
-    ok = save_ppm6(bytes, width(), height(), 3, m_filename);
+    vector<byte> bytes = image->get_byte_arr(3, out.i0, out.i1, out.j0, out.j1);
+    ok = save_ppm6(bytes.data(), out.width(), out.height(), 3, m_filename);
   }
 
   if(!ok) RT3_ERROR("Could not save the image.");
@@ -56,7 +142,7 @@ void Film::write_image() const {
 // Factory function pattern.
 // This is the function that retrieves from the ParamSet object
 // all the information we need to create a Film object.
-Film* create_film(const ParamSet& ps) {
+Film* create_film(const ParamSet& ps, int frame) {
   std::cout << ">>> Inside create_film()\n";
   std::string filename;
   // Let us check whether user has provided an output file name via
@@ -77,12 +163,28 @@ Film* create_film(const ParamSet& ps) {
     // Try yo retrieve filename from scene file.
     filename = retrieve(ps, "filename", std::string{ "image.png" });
   }
+  if (frame >= 0) {
+    // Frame number goes before the extension, zero padded so the frames sort in order.
+    std::string number = std::to_string(frame);
+    number.insert(0, std::max(0, 4 - int(number.size())), '0');
+    auto dot = filename.find_last_of('.');
+    auto slash = filename.find_last_of('/');
+    if (dot == std::string::npos or (slash != std::string::npos and dot < slash)) {
+      dot = filename.size();
+    }
+    filename.insert(dot, "_" + number);
+  }
 
   // Read resolution.
   // Aux function that retrieves info from the ParamSet.
   int xres = retrieve(ps, "x_res", int(1280));
   // Aux function that retrieves info from the ParamSet.
   int yres = retrieve(ps, "y_res", int(720));
+  // The resolution from the command line, if any, overrides the one in the scene file.
+  if (API::curr_run_opt.x_res > 0 and API::curr_run_opt.y_res > 0) {
+    xres = API::curr_run_opt.x_res;
+    yres = API::curr_run_opt.y_res;
+  }
   // Quick render?
   if (API::curr_run_opt.quick_render) {
     // decrease resolution.
@@ -90,13 +192,30 @@ Film* create_film(const ParamSet& ps) {
     yres = std::max(1, yres / 4);
   }
 
-  // TODO
-  // Read crop window information.
+  // Read crop window information: x0 x1 y0 y1, as fractions of the image, y going down.
   std::vector<real_type> cw = retrieve(ps, "crop_window", std::vector<real_type>{ 0, 1, 0, 1 });
-  for (const auto& e : cw) {
-    std::cout << e << " ";
+  // The crop window from the command line, if any, overrides the one in the scene file.
+  const auto& cli_cw = API::curr_run_opt.crop_window;
+  if (cli_cw[0][0] != 0 or cli_cw[0][1] != 1 or cli_cw[1][0] != 0 or cli_cw[1][1] != 1) {
+    cw = { cli_cw[0][0], cli_cw[0][1], cli_cw[1][0], cli_cw[1][1] };
+  }
+  if (cw.size() != 4) {
+    RT3_ERROR("crop_window must have 4 values: x0 x1 y0 y1.");
+  }
+  for (auto& e : cw) {
+    e = std::clamp(e, real_type(0), real_type(1));
+  }
+  // Rounding both ends up, as pbrt does, makes adjacent windows share no pixel and miss none.
+  Film::PixelWindow crop{ int(std::ceil(yres * cw[2])), int(std::ceil(yres * cw[3])),
+                          int(std::ceil(xres * cw[0])), int(std::ceil(xres * cw[1])) };
+  if (crop.width() <= 0 or crop.height() <= 0) {
+    RT3_ERROR("The crop window has no pixels.");
+  }
+  bool write_cropped = retrieve(ps, "crop_output", std::string{ "cropped" }) != "full";
+  if (crop.width() != xres or crop.height() != yres) {
+    std::cout << "Crop window: rows [" << crop.i0 << ", " << crop.i1 << "), columns [" << crop.j0 << ", " << crop.j1
+              << "), writing the " << (write_cropped ? "cropped image" : "full frame") << ".\n";
   }
-  std::cout << '\n';
 
   std::string img_t_str = retrieve(ps, "img_type", std::string{"png"});
 
@@ -106,7 +225,34 @@ Film* create_film(const ParamSet& ps) {
   } else if(img_t_str == "ppm6") {
     img_t = Film::image_type_e::PPM6;
   }
+  Film::Sampling sampling;
+  sampling.spp = std::max(1, retrieve(ps, "spp", int(1)));
+  // A progressive render goes on until its time is up, unless the film caps it.
+  if (API::curr_run_opt.time_budget > 0 and not ps.count("spp")) {
+    sampling.spp = std::numeric_limits<int>::max();
+  }
+  sampling.adaptive = retrieve(ps, "adaptive", std::string{ "false" }) == "true";
+  sampling.min_spp = std::clamp(retrieve(ps, "min_spp", int(4)), 1, sampling.spp);
+  sampling.max_variance = retrieve(ps, "max_variance", real_type(1e-4));
+
   // Note that the image type is fixed here. Must be read from ParamSet, though.
-  return new Film(Point2i{ xres, yres }, filename, img_t);
+  Film* film = new Film(Point2i{ xres, yres }, filename, img_t, sampling, crop, write_cropped);
+
+  // A process of a distributed render writes its tiles next to the image, tagged with its share.
+  const RunningOptions& opt = API::curr_run_opt;
+  if (opt.denoise and not opt.partial_render()) {
+    film->m_guides.resize(film->m_stats.size());
+  }
+  if (opt.partial_render()) {
+    film->m_partial_filename = filename;
+    if (opt.n_buckets > 0) {
+      film->m_partial_filename += ".bucket" + std::to_string(opt.bucket) + "of" + std::to_string(opt.n_buckets);
+    }
+    if (opt.tile_last > opt.tile_first) {
+      film->m_partial_filename += ".tiles" + std::to_string(opt.tile_first) + "-" + std::to_string(opt.tile_last);
+    }
+    film->m_partial_filename += ".rt3part";
+  }
+  return film;
 }
 }  // namespace rt3
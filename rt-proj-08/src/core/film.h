@@ -1,6 +1,8 @@
 #ifndef FILM_H
 #define FILM_H
 
+#include <limits>
+
 #include "rt3.h"
 #include "error.h"
 #include "paramset.h"
@@ -21,11 +23,12 @@ class Film {
         mat = vector<vector<Color>>(mh, vector<Color>(mw));
       }
 
-      byte* get_byte_arr(int d) {
-        byte * bytes = new byte[w * h * d];
+      /// Bytes of rows [i0, i1) and columns [j0, j1), `d` channels per pixel.
+      vector<byte> get_byte_arr(int d, int i0, int i1, int j0, int j1) {
+        vector<byte> bytes((i1 - i0) * (j1 - j0) * d);
         int curr = 0;
-        for(int i = 0; i < h; i++) {
-          for(int j = 0; j < w; j++) {
+        for(int i = i0; i < i1; i++) {
+          for(int j = j0; j < j1; j++) {
             for(int k = 0; k < d; k++) {
               bytes[curr++] = mat[i][j][k] * 255;
             }
@@ -35,14 +38,78 @@ class Film {
       }
     };
 
+    /// Rectangle of pixels: rows [i0, i1) and columns [j0, j1).
+    struct PixelWindow {
+      int i0, i1, j0, j1;
+      int height() const { return i1 - i0; }
+      int width() const { return j1 - j0; }
+
+      /// # of `size` x `size` tiles covering the window.
+      int tile_count(int size) const {
+        return ((width() + size - 1) / size) * ((height() + size - 1) / size);
+      }
+      /// Pixels of tile `id`, tiles being numbered row by row from the window's top left corner.
+      PixelWindow tile(int size, int id) const {
+        int tiles_x = (width() + size - 1) / size;
+        int ti = i0 + (id / tiles_x) * size;
+        int tj = j0 + (id % tiles_x) * size;
+        return PixelWindow{ ti, std::min(ti + size, i1), tj, std::min(tj + size, j1) };
+      }
+    };
+
+    /// How many samples each pixel gets.
+    struct Sampling {
+      int spp = 1;                 //!< Samples per pixel; the most a pixel gets in adaptive or progressive mode.
+      bool adaptive = false;       //!< Shoot `min_spp` samples, then more only where the variance is high.
+      int min_spp = 4;             //!< Samples every pixel gets in adaptive mode, and the size of each extra batch.
+      real_type max_variance = 1e-4; //!< Pixels whose mean has a higher variance (in any channel) get more samples.
+    };
+
+    /// Running sums of the samples of a pixel.
+    struct PixelStats {
+      real_type sum[3] = {0, 0, 0};
+      real_type sum_sq[3] = {0, 0, 0};
+      int count = 0;
+    };
+
+    /// Running sums of what the camera rays of a pixel hit, which guide the denoiser.
+    struct PixelGuide {
+      real_type normal[3] = {0, 0, 0};
+      real_type albedo[3] = {0, 0, 0};
+      real_type depth = 0;  //!< Distance to the hit; 0 for rays that miss the scene.
+      int count = 0;
+    };
+
     //=== Film Public Methods
-    Film(const Point2i& resolution, const std::string& filename, image_type_e imgt);
+    /// \param crop Pixels to render; the others are never traced.
+    /// \param write_cropped Write only the crop window, instead of the full frame with the rest left black.
+    Film(const Point2i& resolution, const std::string& filename, image_type_e imgt, const Sampling& sampling,
+         const PixelWindow& crop, bool write_cropped);
     virtual ~Film();
 
     /// Retrieve original Film resolution.
     [[nodiscard]] Point2i get_resolution() const { return m_full_resolution; }
-    /// Takes a sample `p` and its radiance `L` and updates the image.
+    /// Takes a sample `p` and its radiance `L` and adds it to the pixel, which becomes the mean of its samples.
+    /// It takes no lock: threads may call it at the same time as long as they write different pixels.
     void add_sample(const Point2i&, const Color&);
+    /// # of samples the pixel got so far.
+    int sample_count(const Point2i& p) const { return m_stats[p.x * width() + p.y].count; }
+    /// Estimated variance of the pixel's mean (largest among the channels); 0 with less than 2 samples.
+    real_type variance(const Point2i&) const;
+    /// Most samples a pixel may have right now: `spp`, or less during the early passes of a progressive render.
+    int spp_limit() const { return std::min(m_sampling.spp, m_pass_spp); }
+    /// Whether the pixel should get more samples, as far as `spp_limit()`, adaptive sampling
+    /// and the preview pass go.
+    bool needs_samples(const Point2i&) const;
+    /// Gives the pixels not traced yet the color of the traced pixel at the top left corner of
+    /// their `m_preview_stride` x `m_preview_stride` block, so a preview pass writes a whole image.
+    void fill_preview();
+    /// Whether the integrator should fill in the guide buffers with `add_guide()` (`--denoise`).
+    bool wants_guides() const { return not m_guides.empty(); }
+    /// Adds what a camera ray of the pixel hit: its normal, albedo and distance; a miss has depth 0
+    /// and the background as albedo. Same threading rules as `add_sample()`.
+    void add_guide(const Point2i&, const Vector3f& normal, const Color& albedo, real_type depth);
+    /// Writes the image; with guide buffers, a denoised copy of it (see `denoise()`).
     void write_image() const;
 
     //=== Film Public Data
@@ -51,6 +118,18 @@ class Film {
     image_type_e m_image_type;        //!< Image type, PNG, PPM3, PPM6.
     // TODO: Create the matrix (or vector) that will hold the image data.
     std::unique_ptr< ColorBuffer > m_color_buffer_ptr; //!< Reference to the color buffer (image) object.
+    Sampling m_sampling;              //!< Samples per pixel, from the film's `spp`, `adaptive`, ... parameters.
+    PixelWindow m_crop;               //!< Pixels to render, from the crop window.
+    bool m_write_cropped;             //!< Whether the image written is just the crop window.
+    vector<PixelStats> m_stats;       //!< Sample sums of every pixel, row by row.
+    vector<PixelGuide> m_guides;      //!< Guide sums of every pixel, row by row; empty without `--denoise`.
+    int m_pass_spp = std::numeric_limits<int>::max(); //!< Cap on the samples per pixel of the current pass.
+    int m_preview_stride = 1;         //!< During a preview pass, only every `m_preview_stride`-th row and column is traced.
+    /// For a distributed render (`--bucket`, `--tile-range`): the `.rt3part` file written instead
+    /// of the image, or empty. The integrator fills in the tile layout and the tiles it rendered.
+    std::string m_partial_filename;
+    int m_tile_size = 0;
+    vector<int> m_tiles;
 
     int height() const { return m_full_resolution.y; }
     int width() const { return m_full_resolution.x; }
@@ -58,7 +137,8 @@ class Film {
   };
 
   // Factory pattern. It's not part of this class.
-  Film* create_film(const ParamSet& ps);
+  /// \param frame Frame of an animation, added to the file name (e.g. image_0007.png); -1 for a still.
+  Film* create_film(const ParamSet& ps, int frame = -1);
 }  // namespace rt3
 
 #endif  // FILM_H
@@ -0,0 +1,59 @@
+#ifndef FINGERPRINT_H
+#define FINGERPRINT_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace rt3 {
+
+/*!
+ * 64-bit FNV-1a hash of a sequence of values, to tell cheaply whether two inputs have the
+ * same content. Values are hashed by their bytes, so only types without padding should be
+ * added; strings and vectors are hashed with their size, so that ("ab", "c") and ("a", "bc")
+ * differ. The bytes are taken 8 at a time, which is not the textbook FNV but is 8 times faster.
+ */
+class Fingerprint {
+public:
+    void add_bytes(const void *data, size_t size) {
+        const unsigned char *bytes = static_cast<const unsigned char*>(data);
+        size_t k = 0;
+        for(; k + 8 <= size; k += 8) {
+            uint64_t word;
+            std::memcpy(&word, bytes + k, 8);
+            mix(word);
+        }
+        for(; k < size; ++k) mix(bytes[k]);
+    }
+
+    template <typename T>
+    void add(const T &value) {
+        static_assert(std::is_trivially_copyable<T>::value, "Fingerprint::add() hashes the bytes of a value");
+        add_bytes(&value, sizeof(T));
+    }
+    void add(const std::string &s) {
+        add(s.size());
+        add_bytes(s.data(), s.size());
+    }
+    template <typename T>
+    void add(const std::vector<T> &v) {
+        add(v.size());
+        for(const T &e : v) add(e);
+    }
+
+    uint64_t value() const { return m_hash; }
+
+private:
+    void mix(uint64_t word) {
+        m_hash ^= word;
+        m_hash *= 1099511628211ull;
+    }
+
+    uint64_t m_hash = 14695981039346656037ull;
+};
+
+}
+
+#endif
@@ -1,58 +1,323 @@
 #include "integrator.h"
 #include "material.h"
+#include "api.h"
+#include "thread_pool.h"
+
+#include <atomic>
+#include <limits>
+#include <sstream>
+#include <mutex>
 
 namespace rt3{
 
-void SamplerIntegrator::render( const unique_ptr<Scene> &scene ) {
-    int w = camera->film->width();
-    int h = camera->film->height();
+namespace {
 
+/// Draws the loading bar for `done` out of `total` pixels.
+void print_progress(int done, int total, int &it_bar) {
     const int max_chars = 100;
-    const int max_it = h*w;
-    const int step = max_it/max_chars;
-    const int step_cycle = 100;
     const char simbol = '.';
     const char cycle[4] = {'\\', '|', '/', '-'};
-    int it_bar = 0;
-    int curr_it = 0;
-    
-    for(int i = 0; i < h; i++) {
-        for(int j = 0; j < w; j++) {
-            // Determine the ray for the current camera type.
-            Point2f screen_coord{ float(j)/float(w), float(i)/float(h) };
-            Ray ray = camera->generate_ray(i,j); // Generate the ray from (x,y)
-            // Determine the incoming light.
-            auto temp_L =  Li( ray, scene );
-            Color L = (temp_L.has_value()) ?  temp_L.value() : scene->background->sampleXYZ(screen_coord) ;
-            // Add color (radiance) to the image.
-            camera->film->add_sample( Point2i( i, j ), L ); // Set color of pixel (x,y) to L.
-            
-            // Loading bar
-            if(curr_it % step == 0 || curr_it % step_cycle == 0) {
-                int curr_chars = (curr_it*max_chars)/max_it;
-                std::cout << "\t " << cycle[it_bar] << " " << (curr_it*100/max_it) << "% [";
-                for(int k = 0; k < max_chars; k++) {
-                    if(k < curr_chars) {
-                        std::cout << simbol;
-                    } else {
-                        std::cout << ' ';
-                    }
+
+    int curr_chars = (int)(((long long)done * max_chars) / total);
+    std::cout << "\t " << cycle[it_bar] << " " << (int)(((long long)done * 100) / total) << "% [";
+    for(int k = 0; k < max_chars; k++) {
+        std::cout << ((k < curr_chars) ? simbol : ' ');
+    }
+    std::cout << "]\r";
+    std::cout.flush();
+    it_bar = (it_bar + 1)%4;
+}
+
+}
+
+Point2f SamplerIntegrator::sample_offset( int i, int j, int k, int spp ) {
+    if(spp == 1) return Point2f{ 0.5f, 0.5f };
+
+    // Per pixel shift, so that neighbours don't share the same pattern.
+    uint32_t hash = uint32_t(i) * 0x9E3779B1u ^ uint32_t(j) * 0x85EBCA77u;
+    hash ^= hash >> 16; hash *= 0x7feb352du;
+    hash ^= hash >> 15; hash *= 0x846ca68bu;
+    hash ^= hash >> 16;
+
+    // R2 sequence: k * (1/phi_2, 1/phi_2^2), where phi_2 is the plastic number.
+    real_type u = (hash & 0xffff) / 65536.f + k * 0.7548776662f;
+    real_type v = (hash >> 16) / 65536.f + k * 0.5698402910f;
+    return Point2f{ u - std::floor(u), v - std::floor(v) };
+}
+
+void SamplerIntegrator::add_guide( const Point2i &pixel, const Ray &ray, const Surfel *isect, const unique_ptr<Scene> &scene ) {
+    Film &film = *camera->film;
+    if(isect == nullptr) {
+        Point2f screen_coord{ float(pixel.y)/float(film.width()), float(pixel.x)/float(film.height()) };
+        film.add_guide(pixel, Vector3f{0, 0, 0}, scene->background->sampleXYZ(screen_coord), 0);
+    } else {
+        film.add_guide(pixel, isect->n, scene->materials.flat(isect->material_id), glm::distance(ray.o, isect->p));
+    }
+}
+
+void SamplerIntegrator::render_sample( int i, int j, int k, const unique_ptr<Scene> &scene ) {
+    int w = camera->film->width();
+    int h = camera->film->height();
+
+    // Determine the ray for the current camera type.
+    Point2f screen_coord{ float(j)/float(w), float(i)/float(h) };
+    Ray ray = camera->generate_ray(i, j, sample_offset(i, j, k, camera->film->m_sampling.spp)); // Generate the ray from (x,y)
+    // Determine the incoming light.
+    bool guides = camera->film->wants_guides();
+    shared_ptr<Surfel> primary;
+    auto temp_L =  Li( ray, scene, guides ? &primary : nullptr );
+    Color L = (temp_L.has_value()) ?  temp_L.value() : scene->background->sampleXYZ(screen_coord) ;
+    // Add color (radiance) to the image.
+    camera->film->add_sample( Point2i( i, j ), L ); // Add L to the samples of pixel (x,y).
+    if(guides) add_guide(Point2i( i, j ), ray, primary.get(), scene);
+}
+
+void SamplerIntegrator::render_pixel( int i, int j, const unique_ptr<Scene> &scene ) {
+    const Film &film = *camera->film;
+    const Film::Sampling &sampling = film.m_sampling;
+    int limit = film.spp_limit();
+    int batch = sampling.adaptive ? sampling.min_spp : limit;
+
+    Point2i p{ i, j };
+    while(film.needs_samples(p)) {
+        int n = film.sample_count(p);
+        for(int k = n; k < n + std::min(batch, limit - n); ++k) {
+            render_sample(i, j, k, scene);
+        }
+    }
+}
+
+string SamplerIntegrator::sampling_note() const {
+    const Film::Sampling &sampling = camera->film->m_sampling;
+    if(API::curr_run_opt.time_budget > 0) {
+        std::ostringstream oss;
+        oss << ", progressive for " << API::curr_run_opt.time_budget << " s";
+        if(sampling.spp < std::numeric_limits<int>::max()) oss << " up to " << sampling.spp << " spp";
+        return oss.str();
+    }
+    if(sampling.adaptive) {
+        return ", adaptive " + std::to_string(sampling.min_spp) + " to " + std::to_string(sampling.spp) + " spp";
+    }
+    return (sampling.spp > 1) ? ", " + std::to_string(sampling.spp) + " spp" : string{};
+}
+
+void SamplerIntegrator::print_sampling_stats() const {
+    const Film &film = *camera->film;
+    if(!film.m_sampling.adaptive) return;
+
+    // Only the tiles this process rendered count.
+    long long pixels = 0;
+    long long total = 0;
+    long long maxed = 0;
+    for(int id : film.m_tiles) {
+        Film::PixelWindow t = film.m_crop.tile(film.m_tile_size, id);
+        pixels += t.height() * t.width();
+        for(int i = t.i0; i < t.i1; i++) {
+            for(int j = t.j0; j < t.j1; j++) {
+                int count = film.sample_count(Point2i{ i, j });
+                total += count;
+                maxed += (count >= film.m_sampling.spp);
+            }
+        }
+    }
+    std::cout << "\t Adaptive sampling: " << double(total) / std::max(pixels, 1LL) << " samples per pixel on average, "
+              << maxed << " pixels reached " << film.m_sampling.spp << ".\n";
+}
+
+bool SamplerIntegrator::next_samples( int i0, int i1, int j0, int j1, vector<CameraSample> &samples ) const {
+    const Film &film = *camera->film;
+    const Film::Sampling &sampling = film.m_sampling;
+    int limit = film.spp_limit();
+    int batch = sampling.adaptive ? sampling.min_spp : limit;
+
+    samples.clear();
+    for(int i = i0; i < i1; i++) {
+        for(int j = j0; j < j1; j++) {
+            Point2i p{ i, j };
+            if(!film.needs_samples(p)) continue;
+            int n = film.sample_count(p);
+            for(int k = n; k < n + std::min(batch, limit - n); ++k) {
+                samples.push_back(CameraSample{ p, k });
+            }
+        }
+    }
+    return !samples.empty();
+}
+
+void SamplerIntegrator::render_packets( int i0, int i1, int j0, int j1, const unique_ptr<Scene> &scene ) {
+    int w = camera->film->width();
+    int h = camera->film->height();
+    int spp = camera->film->m_sampling.spp;
+    int limit = camera->film->spp_limit();
+
+    for(int bi = i0; bi < i1; bi += PACKET_H) {
+        for(int bj = j0; bj < j1; bj += PACKET_W) {
+            // Pixels of a tile always have the same # of samples; earlier passes took the first ones.
+            for(int s = camera->film->sample_count(Point2i(bi, bj)); s < limit; ++s) {
+                RayPacket packet;
+                Point2i pixels[RayPacket::SIZE];
+                uint32_t mask = 0;
+                for(int k = 0; k < RayPacket::SIZE; ++k) {
+                    int i = bi + k / PACKET_W;
+                    int j = bj + k % PACKET_W;
+                    if(i >= i1 || j >= j1) continue;
+                    pixels[k] = Point2i(i, j);
+                    packet.set(k, camera->generate_ray(i, j, sample_offset(i, j, s, spp)));
+                    mask |= 1u << k;
+                }
+
+                shared_ptr<Surfel> hits[RayPacket::SIZE];
+                scene->intersect_packet(packet, mask, hits);
+
+                for(int k = 0; k < RayPacket::SIZE; ++k) {
+                    if(!(mask & (1u << k))) continue;
+                    int i = pixels[k].x, j = pixels[k].y;
+                    Point2f screen_coord{ float(j)/float(w), float(i)/float(h) };
+                    Color L = (hits[k] != nullptr) ? shade_hit(packet.rays[k], hits[k]) : scene->background->sampleXYZ(screen_coord);
+                    camera->film->add_sample( pixels[k], L );
+                    if(camera->film->wants_guides()) add_guide(pixels[k], packet.rays[k], hits[k].get(), scene);
                 }
-                std::cout << "]\r";
-                std::cout.flush();
-                it_bar = (it_bar + 1)%4;
             }
-            curr_it++;
         }
     }
+}
+
+bool SamplerIntegrator::render_tiles( int tile_size, const string &note, const TileTask &task, const Clock::time_point *deadline ) {
+    Film &film = *camera->film;
+    // Only the crop window is traced; it is the whole image when no crop is given.
+    // Split it in tiles; each tile is rendered by a single thread.
+    const Film::PixelWindow &crop = film.m_crop;
+    int n_tiles = crop.tile_count(tile_size);
+
+    // In a distributed render, this process takes only its share of the tiles. The layout only depends
+    // on the scene, so every process numbers the tiles the same way.
+    const RunningOptions &opt = API::curr_run_opt;
+    vector<int> tiles;
+    int total_pixels = 0;
+    for(int id = 0; id < n_tiles; ++id) {
+        if(!opt.owns_tile(id)) continue;
+        tiles.push_back(id);
+        Film::PixelWindow t = crop.tile(tile_size, id);
+        total_pixels += t.height() * t.width();
+    }
+    film.m_tile_size = tile_size;
+    film.m_tiles = tiles;
+    if(opt.preview) {
+        // The pool starts the tiles in order, so the centre of the image, where one looks first, comes first.
+        auto dist2 = [&](int id) {
+            Film::PixelWindow t = crop.tile(tile_size, id);
+            long long di = (t.i0 + t.i1) - (crop.i0 + crop.i1), dj = (t.j0 + t.j1) - (crop.j0 + crop.j1);
+            return di * di + dj * dj;
+        };
+        std::stable_sort(tiles.begin(), tiles.end(), [&](int a, int b){ return dist2(a) < dist2(b); });
+    }
+
+    WorkStealingPool pool{ opt.n_threads };
+    std::cout << "\t Rendering " << tiles.size();
+    if(opt.partial_render()) std::cout << " of " << n_tiles;
+    std::cout << " tiles on " << pool.size() << " threads" << note << ".\n";
+    if(tiles.empty()) {
+        RT3_WARNING("No tile falls in this process' share of the image.");
+        return true;
+    }
+
+    std::atomic<int> done_pixels{ 0 };
+    std::atomic<bool> skipped{ false };
+    std::mutex progress_mutex;
+    int it_bar = 0;
+
+    pool.run(tiles.size(), [&](size_t k, int) {
+        if(deadline != nullptr && Clock::now() >= *deadline) {
+            skipped = true;
+            return;
+        }
+
+        Film::PixelWindow t = crop.tile(tile_size, tiles[k]);
+        task(t.i0, t.i1, t.j0, t.j1);
+
+        int done = done_pixels.fetch_add(t.height() * t.width()) + t.height() * t.width();
+        // Loading bar; whoever holds the lock draws it, the others just go on.
+        std::unique_lock<std::mutex> lock{ progress_mutex, std::try_to_lock };
+        if(lock.owns_lock()) print_progress(done, total_pixels, it_bar);
+    });
+
+    if(skipped) {
+        std::cout << "\n\t Out of time, " << done_pixels << " of " << total_pixels << " pixels done in this pass." << std::endl;
+        return false;
+    }
 
+    const int max_chars = 100;
     std::cout << "\t" << "100% [";
     for(int k = 0; k < max_chars; k++) {
-        std::cout << simbol;
+        std::cout << '.';
     }
     std::cout << ']' << std::endl;
+    return true;
+}
+
+void SamplerIntegrator::render_preview( int tile_size, const string &note, const TileTask &task ) {
+    Film &film = *camera->film;
+    film.m_pass_spp = 1;
+    for(int stride : { 16, 4, 2 }) {
+        film.m_preview_stride = stride;
+        std::cout << "\t Preview at 1/" << stride << " of the resolution:\n";
+        render_tiles(tile_size, note, task);
+        film.fill_preview();
+        film.write_image();
+    }
+    film.m_preview_stride = 1;
+    film.m_pass_spp = std::numeric_limits<int>::max();
+}
+
+void SamplerIntegrator::render_passes( int tile_size, const string &note, const TileTask &task ) {
+    Film &film = *camera->film;
+    if(API::curr_run_opt.preview) render_preview(tile_size, note, task);
+    real_type budget = API::curr_run_opt.time_budget;
+    if(budget <= 0) {
+        render_tiles(tile_size, note, task);
+        print_sampling_stats();
+        film.write_image();
+        return;
+    }
+
+    auto start = Clock::now();
+    auto deadline = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(budget));
 
-    camera->film->write_image();
+    // Passes end at 1, 2, 4, 8 and 16 spp, then every 16 spp, so the image is flushed regularly.
+    for(int pass = 1, target = 1; ; ++pass, target = (target < 16) ? 2 * target : target + 16) {
+        film.m_pass_spp = target;
+        std::cout << "\t Pass " << pass << ", up to " << film.spp_limit() << " spp:\n";
+        // The first pass always runs to the end, so that every pixel has a sample.
+        bool complete = render_tiles(tile_size, note, task, (pass > 1) ? &deadline : nullptr);
+        film.write_image();
+
+        double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        std::cout << "\t Pass " << pass << (complete ? " done" : " stopped") << " after " << elapsed << " s.\n";
+        if(!complete || film.spp_limit() == film.m_sampling.spp || Clock::now() >= deadline) break;
+    }
+
+    film.m_pass_spp = std::numeric_limits<int>::max();
+    print_sampling_stats();
+}
+
+void SamplerIntegrator::render( const unique_ptr<Scene> &scene ) {
+    const Film::Sampling &sampling = camera->film->m_sampling;
+    // Packets take the same samples in every pixel, so adaptive sampling and previews go pixel by pixel.
+    bool packets = shades_primary_hits() && API::curr_run_opt.ray_packets && !sampling.adaptive && !API::curr_run_opt.preview;
+    string note = packets ? ", primary rays in packets of " + std::to_string(RayPacket::SIZE) : string{};
+    note += sampling_note();
+
+    render_passes(TILE_SIZE, note, [&](int i0, int i1, int j0, int j1) {
+        if(packets) {
+            render_packets(i0, i1, j0, j1, scene);
+        } else {
+            for(int i = i0; i < i1; i++) {
+                for(int j = j0; j < j1; j++) {
+                    render_pixel(i, j, scene);
+                }
+            }
+        }
+    });
 
     return;
 }
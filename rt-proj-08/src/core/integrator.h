@@ -5,8 +5,17 @@
 #include "surfel.h"
 #include "scene.h"
 
+#include <chrono>
+#include <functional>
+
 namespace rt3 {
 
+/// Sample `index` of a pixel.
+struct CameraSample {
+    Point2i pixel;
+    int index;
+};
+
 class Integrator {
 public:
     virtual ~Integrator(){};
@@ -21,11 +30,66 @@ public:
         camera = std::move(_camera);
     }
 
-    virtual std::optional<Color> Li(const Ray&, const unique_ptr<Scene>&) const = 0;
+    /// Radiance along the ray, or nothing if it misses the scene. If `primary` is given, the
+    /// ray's closest hit goes there (null on a miss), e.g. for the film's guides.
+    virtual std::optional<Color> Li(const Ray&, const unique_ptr<Scene>&, shared_ptr<Surfel> *primary) const = 0;
+
+    /// Integrators whose color depends only on the primary hit return true and implement
+    /// `shade_hit()`; their primary rays are then traced in packets.
+    virtual bool shades_primary_hits() const { return false; }
+    /// Color for the closest hit `isect` of `ray`.
+    virtual Color shade_hit(const Ray&, const shared_ptr<Surfel>&) const { return Color{0, 0, 0}; }
+    /// Renders the image in tiles of TILE_SIZE x TILE_SIZE pixels, on `--threads` threads.
     virtual void render( const unique_ptr<Scene>& );
     // virtual void preprocess( const unique_ptr<Scene>& );
+
+    /// Side of the square tiles the image is split into.
+    static constexpr int TILE_SIZE = 16;
     
 protected:
+    /// Body of a tile: renders the pixels of [i0, i1) x [j0, j1).
+    using TileTask = std::function<void(int i0, int i1, int j0, int j1)>;
+    using Clock = std::chrono::steady_clock;
+    /// Splits the image in `tile_size` x `tile_size` tiles, runs `task` for each on `--threads`
+    /// threads and draws the loading bar. `note` is appended to the start message.
+    /// Tiles not started by `deadline` (if any) are skipped; returns false if that happened.
+    bool render_tiles( int tile_size, const string &note, const TileTask &task, const Clock::time_point *deadline = nullptr );
+    /// With `--preview`, renders every 16th, 4th and 2nd row and column of the image, one sample
+    /// per pixel, writing the image, blocks filled in, after each pass. Tiles go centre first.
+    /// The pixels traced are kept: the full resolution render only traces the others.
+    void render_preview( int tile_size, const string &note, const TileTask &task );
+    /// Renders the image with `render_tiles()` and writes it. With `--time-budget`, renders
+    /// progressive passes instead, each one raising the film's samples per pixel, and writes
+    /// the image after every pass until the time is up or the film's `spp` is reached.
+    /// With `--preview`, `render_preview()` comes first.
+    void render_passes( int tile_size, const string &note, const TileTask &task );
+    /// Position, in [0,1)^2, of sample `k` inside pixel (i, j): the center when there is a single
+    /// sample per pixel, otherwise a 2D golden ratio sequence, shifted by a hash of the pixel.
+    static Point2f sample_offset( int i, int j, int k, int spp );
+    /// Adds the guides of a camera ray of `pixel` (see Film::add_guide()): what `isect` is, or the
+    /// background if it is null.
+    void add_guide( const Point2i &pixel, const Ray&, const Surfel *isect, const unique_ptr<Scene>& );
+    /// Traces sample `k` of pixel (i, j) and adds its color, and the guides of its primary hit
+    /// if the film wants them, to the film.
+    void render_sample( int i, int j, int k, const unique_ptr<Scene>& );
+    /// Samples pixel (i, j) as the film asks: `spp` times, or adaptively.
+    void render_pixel( int i, int j, const unique_ptr<Scene>& );
+    /// Describes the film's sampling for the start message, e.g. ", 16 spp".
+    string sampling_note() const;
+    /// Prints the average # of samples per pixel, for adaptive renders.
+    void print_sampling_stats() const;
+    /// Collects into `samples` the next round of samples of the pixels of [i0, i1) x [j0, j1):
+    /// all of them for uniform sampling, a batch of `min_spp` per noisy pixel for adaptive sampling.
+    /// Returns false once no pixel needs more.
+    bool next_samples( int i0, int i1, int j0, int j1, vector<CameraSample> &samples ) const;
+    /// Renders the pixels of [i0, i1) x [j0, j1) in ray packets of PACKET_H x PACKET_W pixels,
+    /// `spp` packets per group of pixels.
+    void render_packets( int i0, int i1, int j0, int j1, const unique_ptr<Scene>& );
+
+    static constexpr int PACKET_W = 4;
+    static constexpr int PACKET_H = RayPacket::SIZE / PACKET_W;
+
+
     std::unique_ptr<Camera> camera;
 };
 
@@ -34,17 +34,11 @@ namespace rt3{
                         fabsf(p.z)<origin() ? p.z+float_scale()*n.z:p_i.z);
     }
 
-    // bool VisibilityTester::unoccluded(const std::unique_ptr<Scene>& scene){
-    //     Ray light_ray = Ray(light_surfel->p, light_surfel->wo, 0.1, 1);
-    //     return !scene->intersect_p(light_ray, light_surfel->time);
-    // }
-    bool VisibilityTester::unoccluded(const std::unique_ptr<Scene>& scene, const Vector3f& n) {
-        Point3f x = offset_ray(object_surfel->p,1000.0f*n); // TODO: Why 1000?
+    Ray shadow_ray(const Surfel& hit, const Vector3f& n, const Point3f& light_p) {
+        Point3f x = offset_ray(hit.p,1000.0f*n); // TODO: Why 1000?
         // Point3f x = p0.p + (float)0.001 * n; // Carlos Method
 
-        Ray r{x, light_surfel->p - x};
-        //std::shared_ptr<Surfel> isect;
-
-        return (!scene->intersect_p(r, object_surfel->time + 3.0f));
+        return Ray{x, light_p - x, 0, hit.time + 3.0f};
     }
+
 }
\ No newline at end of file
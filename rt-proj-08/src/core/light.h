@@ -5,20 +5,11 @@
 #include "rt3.h"
 #include "scene.h"
 #include "surfel.h"
+#include "light_sample.h"
 
 namespace rt3 {
-// Verifica se há oclusão entre dois pontos de contato.
-
-class VisibilityTester {
-public:
-  std::shared_ptr<Surfel> object_surfel, light_surfel;
-  VisibilityTester() = default;
-
-  VisibilityTester(const std::shared_ptr<Surfel>& obj, const std::shared_ptr<Surfel>& light)
-      : object_surfel(obj), light_surfel(light) {}
-
-    bool unoccluded(const std::unique_ptr<Scene>& scene, const Vector3f& n);
-};
+/// Ray from `hit` (offset along `n`) towards `light_p`; `t_max` is where the test stops.
+Ray shadow_ray(const Surfel& hit, const Vector3f& n, const Point3f& light_p);
 
 class Light {
 public:
@@ -34,10 +25,8 @@ class LightLi : public Light {
 public:
   LightLi(const Color& c, const Vector3f& scl) : Light(c, scl) {}
   virtual ~LightLi(){};
-  /// Retorna a intensidade da luz, direção e o teste oclusão.
-  virtual tuple<Color, Vector3f, unique_ptr<VisibilityTester>> sample_Li(
-    const shared_ptr<Surfel>& hit)
-    = 0;
+  /// Retorna a intensidade da luz, direção e o raio de sombra, sem alocar nada.
+  virtual LightSample sample_Li(const Surfel& hit) const = 0;
   virtual void preprocess(const Scene&) {};
 };
 
@@ -0,0 +1,20 @@
+#ifndef LIGHT_SAMPLE_H
+#define LIGHT_SAMPLE_H
+
+#include "ray.h"
+#include "color.h"
+
+namespace rt3 {
+
+/// A light as seen from a hit. A plain value: sampling a light allocates nothing.
+struct LightSample {
+    Color L;              //!< Radiance reaching the hit.
+    Vector3f wi;          //!< Direction the light travels in, from the light to the hit.
+    real_type distance;   //!< From the hit to the light.
+    Ray shadow;           //!< From the hit (offset off the surface) towards the light; the light
+                          //!< is visible when nothing blocks it before `shadow.t_max`.
+};
+
+}
+
+#endif
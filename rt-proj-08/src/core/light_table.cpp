@@ -0,0 +1,75 @@
+#include "light_table.h"
+
+#include "light.h"
+#include "../lights/ambient.h"
+#include "../lights/directional.h"
+#include "../lights/point.h"
+#include "../lights/spot.h"
+
+namespace rt3 {
+
+LightTable::LightTable(const vector<shared_ptr<Light>> &lights) {
+    for(size_t k = 0; k < lights.size(); ++k) {
+        const Light *light = lights[k].get();
+        if(auto *point = dynamic_cast<const PointLight*>(light)) {
+            m_slots.push_back(Slot{ light_type_e::POINT, int(m_points.I.size()) });
+            m_points.x.push_back(point->position.x);
+            m_points.y.push_back(point->position.y);
+            m_points.z.push_back(point->position.z);
+            m_points.I.push_back(point->color_int);
+        } else if(auto *spot = dynamic_cast<const SpotlightLight*>(light)) {
+            m_slots.push_back(Slot{ light_type_e::SPOT, int(m_spots.I.size()) });
+            m_spots.x.push_back(spot->position.x);
+            m_spots.y.push_back(spot->position.y);
+            m_spots.z.push_back(spot->position.z);
+            m_spots.dx.push_back(spot->lightDirection.x);
+            m_spots.dy.push_back(spot->lightDirection.y);
+            m_spots.dz.push_back(spot->lightDirection.z);
+            m_spots.cutoff.push_back(spot->cutoff);
+            m_spots.falloff.push_back(spot->falloff);
+            m_spots.interval.push_back(spot->angleInterval);
+            m_spots.I.push_back(spot->color_int);
+        } else if(auto *directional = dynamic_cast<const DirectionalLight*>(light)) {
+            m_slots.push_back(Slot{ light_type_e::DIRECTIONAL, int(m_directionals.L.size()) });
+            m_directionals.dx.push_back(directional->direction.x);
+            m_directionals.dy.push_back(directional->direction.y);
+            m_directionals.dz.push_back(directional->direction.z);
+            m_directionals.distance.push_back(directional->min_dist);
+            m_directionals.L.push_back(directional->color_int);
+        } else {
+            m_slots.push_back(Slot{ light_type_e::AMBIENT, -1 });
+            ambient = ambient + light->color_int;
+            continue;
+        }
+        m_direct.push_back(k);
+    }
+}
+
+LightSample LightTable::sample(int light, const Surfel &hit) const {
+    const Slot &slot = m_slots[light];
+    switch(slot.type) {
+        case light_type_e::POINT: return sample_point(slot.index, hit);
+        case light_type_e::SPOT: return sample_spot(slot.index, hit);
+        case light_type_e::DIRECTIONAL: return sample_directional(slot.index, hit);
+        default: return LightSample{};
+    }
+}
+
+LightSample LightTable::sample_point(int k, const Surfel &hit) const {
+    Point3f position{ m_points.x[k], m_points.y[k], m_points.z[k] };
+    return PointLight::sample(position, m_points.I[k], hit);
+}
+
+LightSample LightTable::sample_spot(int k, const Surfel &hit) const {
+    Point3f position{ m_spots.x[k], m_spots.y[k], m_spots.z[k] };
+    Vector3f axis{ m_spots.dx[k], m_spots.dy[k], m_spots.dz[k] };
+    return SpotlightLight::sample(position, axis, m_spots.I[k], m_spots.cutoff[k], m_spots.falloff[k],
+                                  m_spots.interval[k], hit);
+}
+
+LightSample LightTable::sample_directional(int k, const Surfel &hit) const {
+    Vector3f direction{ m_directionals.dx[k], m_directionals.dy[k], m_directionals.dz[k] };
+    return DirectionalLight::sample(direction, m_directionals.L[k], m_directionals.distance[k], hit);
+}
+
+}
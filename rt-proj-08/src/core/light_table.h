@@ -0,0 +1,65 @@
+#ifndef LIGHT_TABLE_H
+#define LIGHT_TABLE_H
+
+#include "light_sample.h"
+#include "surfel.h"
+
+namespace rt3 {
+
+class Light;
+
+/*!
+ * The lights of a scene, compiled once when the scene is built: the ambient lights are
+ * summed into one color, and the point, spot and directional lights are copied into
+ * one array per field and type, so shading needs neither RTTI nor virtual calls.
+ * Lights are still known by their index in `Scene::lights`.
+ */
+class LightTable {
+public:
+    enum class light_type_e : int { AMBIENT = 0, POINT, SPOT, DIRECTIONAL };
+
+    LightTable() = default;
+    explicit LightTable(const vector<shared_ptr<Light>> &lights);
+
+    Color ambient;  //!< Sum of the ambient lights.
+
+    /// Indices of the lights that are not ambient.
+    const vector<int>& direct() const { return m_direct; }
+    light_type_e type(int light) const { return m_slots[light].type; }
+
+    /// Light `light` (not an ambient one) as seen from `hit`; same as its `LightLi::sample_Li()`.
+    LightSample sample(int light, const Surfel &hit) const;
+
+private:
+    struct Slot {
+        light_type_e type;
+        int index;  //!< In the arrays of its type.
+    };
+
+    LightSample sample_point(int k, const Surfel &hit) const;
+    LightSample sample_spot(int k, const Surfel &hit) const;
+    LightSample sample_directional(int k, const Surfel &hit) const;
+
+    vector<Slot> m_slots;   //!< Indexed like `Scene::lights`.
+    vector<int> m_direct;
+
+    struct {
+        vector<real_type> x, y, z;
+        vector<Color> I;
+    } m_points;
+    struct {
+        vector<real_type> x, y, z;
+        vector<real_type> dx, dy, dz;               //!< Axis of the cone.
+        vector<real_type> cutoff, falloff, interval; //!< Degrees.
+        vector<Color> I;
+    } m_spots;
+    struct {
+        vector<real_type> dx, dy, dz;
+        vector<real_type> distance;  //!< How far away the light is put for the shadow ray.
+        vector<Color> L;
+    } m_directionals;
+};
+
+}
+
+#endif
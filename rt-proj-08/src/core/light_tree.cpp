@@ -0,0 +1,256 @@
+#include "light_tree.h"
+
+#include <algorithm>
+
+#include "../lights/ambient.h"
+#include "../lights/point.h"
+#include "../lights/spot.h"
+
+namespace rt3 {
+
+namespace {
+
+constexpr real_type PI = real_type(M_PI);
+
+real_type safe_acos(real_type c) { return std::acos(std::clamp(c, real_type(-1), real_type(1))); }
+
+/// Smallest cone holding cones (a, ta) and (b, tb), as in pbrt's DirectionCone::Union().
+void merge_cones(const Vector3f &a, real_type ta, const Vector3f &b, real_type tb, Vector3f &axis, real_type &theta) {
+    axis = a;
+    theta = PI;
+    if(ta >= PI || tb >= PI) return;
+
+    real_type d = safe_acos(glm::dot(a, b));
+    if(std::min(d + tb, PI) <= ta) { theta = ta; return; }
+    if(std::min(d + ta, PI) <= tb) { axis = b; theta = tb; return; }
+
+    real_type t = (ta + d + tb) / 2;
+    Vector3f ortho = b - glm::dot(a, b) * a;
+    real_type len = glm::length(ortho);
+    if(t >= PI || len < 1e-6f) return;
+
+    // Turn `a` towards `b` until the cone reaches both.
+    real_type r = t - ta;
+    axis = std::cos(r) * a + std::sin(r) * (ortho / len);
+    theta = t;
+}
+
+/// Random number in [0, 1) from `state`, which is advanced.
+real_type next_random(uint32_t &state) {
+    state = state * 1664525u + 1013904223u;
+    uint32_t h = state;
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    return (h >> 8) * (1.0f / 16777216.0f);
+}
+
+}
+
+LightTree::LightTree(const vector<shared_ptr<Light>> &lights) {
+    vector<Node> leaves;
+    for(size_t k = 0; k < lights.size(); ++k) {
+        Light *light = lights[k].get();
+        Node leaf;
+        if(auto *point = dynamic_cast<PointLight*>(light)) {
+            leaf.box = Bounds3f(point->position, point->position);
+            leaf.axis = Vector3f{0, 0, 1};
+            leaf.theta = PI;
+        } else if(auto *spot = dynamic_cast<SpotlightLight*>(light)) {
+            leaf.box = Bounds3f(spot->position, spot->position);
+            leaf.axis = spot->lightDirection;
+            leaf.theta = std::min(Radians(spot->cutoff), PI);
+        } else {
+            if(typeid(*light) != typeid(AmbientLight)) m_unbounded.push_back(k);
+            continue;
+        }
+        Color c = light->color_int;
+        for(int ch = 0; ch < 3; ++ch) {
+            leaf.power[ch] = c[ch];
+            leaf.rep_I[ch] = c[ch];
+            leaf.ch_light[ch] = k;
+            leaf.ch_I[ch] = c[ch];
+            leaf.scale[ch] = (c[ch] > 0) ? 1 : 0;
+        }
+        leaf.light = k;
+        leaves.push_back(leaf);
+    }
+
+    if(leaves.empty()) return;
+    vector<int> ids(leaves.size());
+    for(size_t k = 0; k < ids.size(); ++k) ids[k] = k;
+    m_nodes.reserve(2 * leaves.size() - 1);
+    m_root = build(leaves, ids, 0, ids.size());
+}
+
+int LightTree::build(vector<Node> &leaves, vector<int> &ids, int begin, int end) {
+    if(end - begin == 1) {
+        m_nodes.push_back(leaves[ids[begin]]);
+        return m_nodes.size() - 1;
+    }
+
+    // Median split along the longest axis of the positions' bounds.
+    Bounds3f box;
+    for(int k = begin; k < end; ++k) box = Bounds3f::insert(box, leaves[ids[k]].box);
+    Vector3f extent = box.max_point - box.min_point;
+    int axis = (extent.x > extent.y && extent.x > extent.z) ? 0 : (extent.y > extent.z ? 1 : 2);
+    int mid = (begin + end) / 2;
+    std::nth_element(ids.begin() + begin, ids.begin() + mid, ids.begin() + end, [&](int a, int b) {
+        return leaves[a].box.min_point[axis] < leaves[b].box.min_point[axis];
+    });
+
+    int left = build(leaves, ids, begin, mid);
+    int right = build(leaves, ids, mid, end);
+    const Node &l = m_nodes[left];
+    const Node &r = m_nodes[right];
+
+    Node node;
+    node.box = Bounds3f::insert(l.box, r.box);
+    merge_cones(l.axis, l.theta, r.axis, r.theta, node.axis, node.theta);
+    real_type sum_l = 0, sum_r = 0;
+    for(int ch = 0; ch < 3; ++ch) {
+        node.power[ch] = l.power[ch] + r.power[ch];
+        sum_l += l.rep_I[ch];
+        sum_r += r.rep_I[ch];
+    }
+    // The representative is the brighter of the children's representatives.
+    const Node &rep = (sum_l >= sum_r) ? l : r;
+    node.light = rep.light;
+    for(int ch = 0; ch < 3; ++ch) {
+        node.rep_I[ch] = rep.rep_I[ch];
+        if(rep.rep_I[ch] > 0) {
+            node.ch_light[ch] = rep.light;
+            node.ch_I[ch] = rep.rep_I[ch];
+        } else {
+            // The representative is black here: the brighter of the children's lights for the channel stands in.
+            const Node &best = (l.ch_I[ch] >= r.ch_I[ch]) ? l : r;
+            node.ch_light[ch] = best.ch_light[ch];
+            node.ch_I[ch] = best.ch_I[ch];
+        }
+        node.scale[ch] = (node.ch_I[ch] > 0) ? node.power[ch] / node.ch_I[ch] : 0;
+    }
+    node.left = left;
+    node.right = right;
+    m_nodes.push_back(node);
+    return m_nodes.size() - 1;
+}
+
+real_type LightTree::bound(const Node &node, const Point3f &p, const Vector3f &n, const Color &kd, const Color &ks) const {
+    Point3f center = (node.box.min_point + node.box.max_point) * 0.5f;
+    real_type radius = glm::length(node.box.max_point - center);
+    Vector3f to_lights = center - p;
+    real_type dist2 = glm::dot(to_lights, to_lights);
+
+    real_type cos_diffuse = 1;
+    // Outside the bounding sphere, the lights are seen within `theta_b` of the direction to its center.
+    if(dist2 > radius * radius) {
+        real_type dist = std::sqrt(dist2);
+        Vector3f w = to_lights / dist;
+        real_type theta_b = std::asin(radius / dist);
+
+        // Best case angle between the normal and a light.
+        real_type theta_n = std::max(real_type(0), safe_acos(glm::dot(n, w)) - theta_b);
+        cos_diffuse = (theta_n < PI / 2) ? std::cos(theta_n) : 0;
+
+        // The hit must be inside some light's cone.
+        if(node.theta < PI && safe_acos(glm::dot(node.axis, -w)) - theta_b > node.theta) return 0;
+    }
+
+    // The specular lobe is bounded by 1: Blinn-Phong adds it even for lights below the surface.
+    Color d = kd, s = ks;
+    real_type b = 0;
+    for(int ch = 0; ch < 3; ++ch) {
+        b = std::max(b, node.power[ch] * (d[ch] * cos_diffuse + s[ch]));
+    }
+    return b;
+}
+
+void LightTree::cut(const Point3f &p, const Vector3f &n, const Color &kd, const Color &ks, real_type threshold,
+                    vector<LightPick> &picks) const {
+    if(m_nodes.empty()) return;
+
+    // The cut's inner nodes, as a max-heap by bound; its leaves go straight to `picks`.
+    thread_local vector<std::pair<real_type, int>> heap;
+    heap.clear();
+    real_type total = 0;
+    auto add = [&](int id) {
+        real_type b = bound(m_nodes[id], p, n, kd, ks);
+        if(b <= 0) return;
+        total += b;
+        const Node &node = m_nodes[id];
+        if(node.left < 0) {
+            picks.push_back(LightPick{ node.light, { 1, 1, 1 } });
+        } else {
+            heap.push_back({b, id});
+            std::push_heap(heap.begin(), heap.end());
+        }
+    };
+
+    add(m_root);
+    while(!heap.empty() && heap.front().first > threshold * total) {
+        auto [b, id] = heap.front();
+        std::pop_heap(heap.begin(), heap.end());
+        heap.pop_back();
+        total -= b;
+        add(m_nodes[id].left);
+        add(m_nodes[id].right);
+    }
+
+    // What is left is dim enough to be shaded by the representatives.
+    for(auto [b, id] : heap) add_representatives(m_nodes[id], picks);
+}
+
+void LightTree::add_representatives(const Node &node, vector<LightPick> &picks) {
+    // Usually a single light stands for all channels; one pick per distinct light otherwise.
+    for(int ch = 0; ch < 3; ++ch) {
+        if(node.scale[ch] <= 0) continue;
+        bool done = false;
+        for(int prev = 0; prev < ch; ++prev) {
+            done = done || (node.scale[prev] > 0 && node.ch_light[prev] == node.ch_light[ch]);
+        }
+        if(done) continue;
+
+        LightPick pick{ node.ch_light[ch], { 0, 0, 0 } };
+        for(int c = ch; c < 3; ++c) {
+            if(node.ch_light[c] == node.ch_light[ch]) pick.weight[c] = node.scale[c];
+        }
+        picks.push_back(pick);
+    }
+}
+
+void LightTree::sample(const Point3f &p, const Vector3f &n, const Color &kd, const Color &ks, int n_samples,
+                       uint32_t seed, vector<LightPick> &picks) const {
+    if(m_nodes.empty()) return;
+
+    uint32_t state = seed;
+    for(int s = 0; s < n_samples; ++s) {
+        int id = m_root;
+        real_type pdf = 1;
+        if(bound(m_nodes[m_root], p, n, kd, ks) <= 0) return;
+
+        while(id >= 0 && m_nodes[id].left >= 0) {
+            const Node &node = m_nodes[id];
+            real_type bl = bound(m_nodes[node.left], p, n, kd, ks);
+            real_type br = bound(m_nodes[node.right], p, n, kd, ks);
+            // Bounds of the children are not always within the parent's; both may be 0.
+            if(bl + br <= 0) {
+                id = -1;
+                break;
+            }
+            real_type p_left = bl / (bl + br);
+            if(next_random(state) < p_left) {
+                id = node.left;
+                pdf *= p_left;
+            } else {
+                id = node.right;
+                pdf *= 1 - p_left;
+            }
+        }
+
+        if(id < 0) continue;
+        real_type weight = 1 / (pdf * n_samples);
+        picks.push_back(LightPick{ m_nodes[id].light, { weight, weight, weight } });
+    }
+}
+
+}
@@ -0,0 +1,79 @@
+#ifndef LIGHT_TREE_H
+#define LIGHT_TREE_H
+
+#include "light.h"
+#include "bounds.h"
+
+namespace rt3 {
+
+/// A light to shade a hit with, and the factors (per channel) its intensity is scaled by.
+struct LightPick {
+    int light;            //!< Index in `Scene::lights`.
+    real_type weight[3];
+};
+
+/*!
+ * Bounding volume hierarchy over the point and spot lights of a scene.
+ *
+ * A node bounds its lights' positions and emission cones and sums their intensities, so
+ * how much its lights may add to a hit is bounded without visiting them. Lights have no
+ * distance falloff here, so the bound only drops where the lights are behind the hit or
+ * the hit is outside their cones. Each node also keeps its brightest light as a
+ * representative, which can stand for the whole node with the node's intensity. A channel
+ * the representative has no intensity in (e.g. green, for a red light) is stood for by the
+ * node's brightest light in that channel instead.
+ */
+class LightTree {
+public:
+    explicit LightTree(const vector<shared_ptr<Light>> &lights);
+
+    /// # of point and spot lights in the tree.
+    size_t size() const { return m_nodes.empty() ? 0 : (m_nodes.size() + 1) / 2; }
+    /// Lights the tree does not hold (e.g. directional ones), other than ambient lights.
+    const vector<int>& unbounded() const { return m_unbounded; }
+
+    /// A light cut for the hit at `p` with normal `n`, for a material of diffuse and specular
+    /// colors `kd`, `ks`. Starting from the root, the node with the largest bound is split
+    /// until every bound is below `threshold` times their sum; each node of the cut is then
+    /// shaded by its representative. Nodes whose bound is 0 are dropped. With `threshold` 0
+    /// the cut has every light the hit may see, each one on its own.
+    void cut(const Point3f &p, const Vector3f &n, const Color &kd, const Color &ks, real_type threshold,
+             vector<LightPick> &picks) const;
+
+    /// Picks `n_samples` lights at random, going down from the root to a child with a probability
+    /// proportional to its bound. Each pick is weighted by 1 / (probability * n_samples).
+    /// The random numbers come from `seed`, so a hit is always shaded the same way.
+    void sample(const Point3f &p, const Vector3f &n, const Color &kd, const Color &ks, int n_samples,
+                uint32_t seed, vector<LightPick> &picks) const;
+
+private:
+    struct Node {
+        Bounds3f box;          //!< Bounds of the lights' positions.
+        real_type power[3];    //!< Summed intensity of the lights.
+        Vector3f axis;         //!< The lights emit only within `theta` radians of `axis`...
+        real_type theta;       //!< ... pi means in every direction.
+        int light;             //!< Representative: the brightest light (index in `Scene::lights`).
+        real_type rep_I[3];    //!< The representative's intensity.
+        int ch_light[3];       //!< Light that stands for each channel: `light`, unless it is black there.
+        real_type ch_I[3];     //!< Intensity of `ch_light` in its channel.
+        real_type scale[3];    //!< `power` over `ch_I`; 0 where `power` is.
+        int left = -1, right = -1; //!< Children; -1 for a leaf.
+    };
+
+    /// Most that the lights of `node` may add to a channel of the hit.
+    real_type bound(const Node &node, const Point3f &p, const Vector3f &n, const Color &kd, const Color &ks) const;
+
+    /// Adds to `picks` the representatives of `node`, weighted to stand for all of its lights.
+    static void add_representatives(const Node &node, vector<LightPick> &picks);
+
+    /// Builds the subtree over `ids[begin, end)`, returns its node.
+    int build(vector<Node> &leaves, vector<int> &ids, int begin, int end);
+
+    vector<Node> m_nodes; //!< Children before their parents.
+    int m_root = -1;
+    vector<int> m_unbounded;
+};
+
+}
+
+#endif
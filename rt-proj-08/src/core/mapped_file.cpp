@@ -0,0 +1,34 @@
+#include "mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace rt3 {
+
+std::shared_ptr<MappedFile> MappedFile::open( const std::string &filename ) {
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if(fd < 0) return nullptr;
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    size_t size = static_cast<size_t>(st.st_size);
+    void *ptr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps its own reference to the file.
+    ::close(fd);
+
+    if(ptr == MAP_FAILED) return nullptr;
+
+    return std::shared_ptr<MappedFile>(new MappedFile(static_cast<const char*>(ptr), size));
+}
+
+MappedFile::~MappedFile() {
+    munmap(const_cast<char*>(m_data), m_size);
+}
+
+} // namespace rt3
@@ -0,0 +1,35 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace rt3 {
+
+/// Read-only memory mapping of a whole file (POSIX `mmap`).
+/// The mapping lives as long as the object; share it through a `shared_ptr`
+/// whenever other objects keep pointers into the mapped bytes.
+class MappedFile {
+public:
+    ~MappedFile();
+
+    MappedFile( const MappedFile& ) = delete;
+    MappedFile& operator=( const MappedFile& ) = delete;
+
+    /// Maps `filename`; returns `nullptr` if the file can't be opened or mapped.
+    static std::shared_ptr<MappedFile> open( const std::string &filename );
+
+    const char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    MappedFile( const char *data, size_t size ) : m_data(data), m_size(size) {}
+
+    const char *m_data; //!< First byte of the mapping.
+    size_t m_size;      //!< Length of the mapping, in bytes.
+};
+
+} // namespace rt3
+
+#endif // MAPPED_FILE_H
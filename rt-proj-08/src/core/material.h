@@ -9,6 +9,8 @@ class Material{
 public:
     Material() = default;
     virtual ~Material() = default;
+
+    int id = 0; //!< Index in the scene's `MaterialTable`; 0 (no material) until the API registers it.
 };
     
 } // namespace rt3
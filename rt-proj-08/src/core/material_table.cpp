@@ -0,0 +1,30 @@
+#include "material_table.h"
+
+#include "../materials/flat.h"
+#include "../materials/ping_pong.h"
+
+namespace rt3 {
+
+MaterialTable::MaterialTable(const vector<shared_ptr<Material>> &materials) : MaterialTable() {
+    for(const auto &material : materials) {
+        size_t id = material->id;
+        if(id >= m_flat.size()) {
+            m_blinn_phong.resize(id + 1);
+            m_flat.resize(id + 1);
+        }
+
+        BlinnPhongParams params;
+        Color flat;
+        if(auto *blinn = dynamic_cast<const PingPongMaterial*>(material.get())) {
+            params = BlinnPhongParams{ blinn->ambient, blinn->diffuse, blinn->specular, blinn->mirror, blinn->glossiness };
+            flat = blinn->diffuse;
+        } else if(auto *flat_material = dynamic_cast<const FlatMaterial*>(material.get())) {
+            params.ambient = flat_material->color;
+            flat = flat_material->color;
+        }
+        m_blinn_phong[id] = params;
+        m_flat[id] = flat;
+    }
+}
+
+}
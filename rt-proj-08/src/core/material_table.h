@@ -0,0 +1,40 @@
+#ifndef MATERIAL_TABLE_H
+#define MATERIAL_TABLE_H
+
+#include "material.h"
+
+namespace rt3 {
+
+/// Blinn-Phong parameters of a material, as plain values.
+struct BlinnPhongParams {
+    Color ambient, diffuse, specular, mirror;
+    real_type glossiness = 0;
+};
+
+/*!
+ * The parameters of every material of a scene, compiled once when the scene is built and
+ * indexed by `Material::id` (which hits carry in `Surfel::material_id`), so that shading
+ * needs neither casts nor shared pointers. Entry 0 stands for "no material" and is black.
+ *
+ * Each material has an entry in every table: a flat material is a Blinn-Phong material
+ * with just an ambient term, and a Blinn-Phong material shows its diffuse color when flat.
+ */
+class MaterialTable {
+public:
+    MaterialTable() : m_blinn_phong(1), m_flat(1) {}
+    /// Every material must have a distinct id, above 0.
+    explicit MaterialTable(const vector<shared_ptr<Material>> &materials);
+
+    size_t size() const { return m_flat.size() - 1; }
+
+    const BlinnPhongParams& blinn_phong(int id) const { return m_blinn_phong[id]; }
+    const Color& flat(int id) const { return m_flat[id]; }
+
+private:
+    vector<BlinnPhongParams> m_blinn_phong;
+    vector<Color> m_flat;
+};
+
+}
+
+#endif
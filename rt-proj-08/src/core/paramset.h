@@ -6,11 +6,15 @@
 #include <memory>
 #include <string>
 
+#include "fingerprint.h"
+
 /// Pure virtual basic type. The map stores a pointer to the base class
 class ValueBase {
 public:
   ValueBase() = default;
   virtual ~ValueBase() = default;
+  /// Adds the stored value to `fp`.
+  virtual void add_to(rt3::Fingerprint& fp) const = 0;
 };
 
 /// We must convert the base class object to the proper derived class object.
@@ -36,12 +40,22 @@ public:
 
   /// Retrieve value.
   T value() { return m_value; }
+  void add_to(rt3::Fingerprint& fp) const override { fp.add(m_value); }
 };
 
 namespace rt3 {
 // The ParamSet is just a heterogeneous hash table. All keys are strings.
 using ParamSet = std::map<std::string, std::shared_ptr<ValueBase>>;
 
+/// Adds every key of `ps` and its value to `fp`.
+inline void add_to(Fingerprint& fp, const ParamSet& ps) {
+  fp.add(ps.size());
+  for (const auto& [key, value] : ps) {
+    fp.add(key);
+    value->add_to(fp);
+  }
+}
+
 /*!
  * This is an auxiliary function to avoid the *verbose* access associated
  * with the std::map<>.
@@ -21,6 +21,7 @@ using rt3::Vector3i;
 /// This is the entry function for the parsing process.
 void parse(const char* scene_file_name) {
   tinyxml2::XMLDocument xml_doc;
+  API::watched_files.insert(scene_file_name);
 
   // Load file.
   if (xml_doc.LoadFile(scene_file_name) != tinyxml2::XML_SUCCESS) {
@@ -115,7 +116,12 @@ void parse_tags(tinyxml2::XMLElement* p_element, int level) {
         { param_type_e::INT, "x_res" },
         { param_type_e::INT, "y_res" },
         { param_type_e::ARR_REAL, "crop_window" },
-        { param_type_e::STRING, "gamma_corrected" }  // bool
+        { param_type_e::STRING, "crop_output" },     // "cropped" or "full"
+        { param_type_e::STRING, "gamma_corrected" }, // bool
+        { param_type_e::INT, "spp" },
+        { param_type_e::STRING, "adaptive" },        // bool
+        { param_type_e::INT, "min_spp" },
+        { param_type_e::REAL, "max_variance" }
       };
       parse_parameters(p_element, param_list, /* out */ &ps);
 
@@ -128,6 +134,16 @@ void parse_tags(tinyxml2::XMLElement* p_element, int level) {
 
       parse_parameters(p_element, param_list, /* out */ &ps);
       API::lookat(ps);
+    } else if (tag_name == "camera_path") {
+      ParamSet ps;
+      // Lookat keyframes; `look_at` and `up` may also have a single value, shared by all keyframes.
+      vector<std::pair<param_type_e, string>> param_list{ { param_type_e::ARR_POINT3F, "look_from" },
+                                                          { param_type_e::ARR_POINT3F, "look_at" },
+                                                          { param_type_e::ARR_VEC3F, "up" },
+                                                          { param_type_e::INT, "frames" } };
+
+      parse_parameters(p_element, param_list, /* out */ &ps);
+      API::camera_path(ps);
     } else if (tag_name == "world_begin") {
       // std::clog << ">>> Entering WorldBegin, at level " << level+1 <<
       // std::endl;
@@ -177,6 +193,13 @@ void parse_tags(tinyxml2::XMLElement* p_element, int level) {
       vector<std::pair<param_type_e, string>> param_list{ 
         { param_type_e::STRING, "type" },
         {param_type_e::INT, "depth"}, 
+        { param_type_e::REAL, "min_throughput" },
+        { param_type_e::STRING, "mode" },             // "recursive", "wavefront" or "deferred"
+        { param_type_e::STRING, "sort_reflections" }, // bool
+        { param_type_e::STRING, "shadow_packets" },   // bool
+        { param_type_e::STRING, "light_sampling" },   // "all", "tree" or "stochastic"
+        { param_type_e::REAL, "light_threshold" },
+        { param_type_e::INT, "light_samples" },
       };
       parse_parameters(p_element, param_list, /* out */ &ps);
       API::integrator(ps);
@@ -196,7 +219,10 @@ void parse_tags(tinyxml2::XMLElement* p_element, int level) {
         { param_type_e::BOOL , "reverse_vertex_order" }, 
         { param_type_e::BOOL , "compute_normals" },      
         { param_type_e::BOOL , "backface_cull" },        
-        { param_type_e::STRING , "filename" }
+        { param_type_e::STRING , "filename" },
+        { param_type_e::STRING , "lazy" }, // bool
+        { param_type_e::POINT3F , "bounds_min" },
+        { param_type_e::POINT3F , "bounds_max" }
       };
       parse_parameters(p_element, param_list, /* out */ &ps);
       API::object(ps);
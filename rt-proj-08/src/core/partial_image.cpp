@@ -0,0 +1,122 @@
+#include "partial_image.h"
+
+#include <climits>
+#include <cstring>
+#include <fstream>
+
+namespace rt3 {
+
+bool PartialImage::same_frame(const PartialImage &other) const {
+    // Everything but the # of tiles must match; the header has no padding, so memcmp will do.
+    RT3PartHeader a = header, b = other.header;
+    a.n_tiles = b.n_tiles = 0;
+    return std::memcmp(&a, &b, sizeof(a)) == 0 && filename == other.filename;
+}
+
+bool save_partial_image( const std::string &filename, const Film &film, int tile_size, const vector<int> &tiles ) {
+    RT3PartHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, RT3PART_MAGIC, sizeof(header.magic));
+    header.version = RT3PART_VERSION;
+    header.byte_order = RT3PART_BYTE_ORDER;
+    header.width = film.width();
+    header.height = film.height();
+    const Film::PixelWindow &crop = film.m_crop;
+    header.crop[0] = crop.i0; header.crop[1] = crop.i1;
+    header.crop[2] = crop.j0; header.crop[3] = crop.j1;
+    header.write_cropped = film.m_write_cropped;
+    header.image_type = static_cast<int32_t>(film.m_image_type);
+    header.tile_size = tile_size;
+    header.total_tiles = crop.tile_count(tile_size);
+    header.spp = film.m_sampling.spp;
+    header.adaptive = film.m_sampling.adaptive;
+    header.min_spp = film.m_sampling.min_spp;
+    header.max_variance = film.m_sampling.max_variance;
+    header.n_tiles = tiles.size();
+    header.name_length = film.m_filename.size();
+
+    std::ofstream ofs{filename, std::ios::binary};
+    if(!ofs.is_open()) {
+        RT3_WARNING("Could not open \"" + filename + "\" for writing.");
+        return false;
+    }
+
+    ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    ofs.write(film.m_filename.data(), film.m_filename.size());
+    vector<float> rgb;
+    for(int id : tiles) {
+        Film::PixelWindow t = crop.tile(tile_size, id);
+        rgb.clear();
+        for(int i = t.i0; i < t.i1; i++) {
+            for(int j = t.j0; j < t.j1; j++) {
+                const Color &c = film.m_color_buffer_ptr->mat[i][j];
+                rgb.insert(rgb.end(), { c.r, c.g, c.b });
+            }
+        }
+        int32_t id32 = id;
+        ofs.write(reinterpret_cast<const char*>(&id32), sizeof(id32));
+        ofs.write(reinterpret_cast<const char*>(rgb.data()), rgb.size() * sizeof(float));
+    }
+
+    return ofs.good();
+}
+
+bool load_partial_image( const std::string &filename, PartialImage &part ) {
+    std::ifstream ifs{filename, std::ios::binary};
+    RT3PartHeader &header = part.header;
+    if(!ifs.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+        RT3_WARNING("\"" + filename + "\" is too small to be a .rt3part file.");
+        return false;
+    }
+
+    if(std::memcmp(header.magic, RT3PART_MAGIC, sizeof(header.magic)) != 0) {
+        RT3_WARNING("\"" + filename + "\" is not a .rt3part file.");
+        return false;
+    }
+    if(header.byte_order != RT3PART_BYTE_ORDER) {
+        RT3_WARNING("\"" + filename + "\" was written with a different byte order.");
+        return false;
+    }
+    if(header.version != RT3PART_VERSION) {
+        RT3_WARNING("\"" + filename + "\" has an unsupported version (" + std::to_string(header.version) + ").");
+        return false;
+    }
+
+    Film::PixelWindow crop = part.crop();
+    bool ok = header.width > 0 && header.height > 0 && header.tile_size > 0
+           && 0 <= crop.i0 && crop.i0 < crop.i1 && crop.i1 <= header.height
+           && 0 <= crop.j0 && crop.j0 < crop.j1 && crop.j1 <= header.width
+           && header.total_tiles == crop.tile_count(header.tile_size)
+           && header.name_length <= PATH_MAX;
+    if(!ok) {
+        RT3_WARNING("\"" + filename + "\" has a corrupted header.");
+        return false;
+    }
+
+    part.filename.resize(header.name_length);
+    ifs.read(&part.filename[0], header.name_length);
+
+    part.tiles.clear();
+    part.rgb.clear();
+    for(uint32_t k = 0; k < header.n_tiles; ++k) {
+        int32_t id;
+        if(!ifs.read(reinterpret_cast<char*>(&id), sizeof(id))) break;
+        if(id < 0 || id >= header.total_tiles) {
+            RT3_WARNING("\"" + filename + "\" has an out of range tile (" + std::to_string(id) + ").");
+            return false;
+        }
+        Film::PixelWindow t = crop.tile(header.tile_size, id);
+        size_t offset = part.rgb.size();
+        part.rgb.resize(offset + 3 * size_t(t.height()) * t.width());
+        ifs.read(reinterpret_cast<char*>(part.rgb.data() + offset), (part.rgb.size() - offset) * sizeof(float));
+        part.tiles.push_back(id);
+    }
+
+    if(!ifs) {
+        RT3_WARNING("\"" + filename + "\" is truncated.");
+        return false;
+    }
+    return true;
+}
+
+}
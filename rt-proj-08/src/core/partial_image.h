@@ -0,0 +1,64 @@
+#ifndef PARTIAL_IMAGE_H
+#define PARTIAL_IMAGE_H
+
+#include <cstdint>
+
+#include "film.h"
+
+namespace rt3 {
+
+/*
+ * Layout of a `.rt3part` file (version 1), host byte order:
+ *
+ *   RT3PartHeader
+ *   image file name  name_length chars
+ *   tiles            n_tiles x { int32 tile id, RGB floats of the tile's pixels, row by row }
+ *
+ * A `.rt3part` file holds the tiles one process rendered in a distributed render
+ * (`--bucket`, `--tile-range`); `rt3-merge` puts the pieces of a frame together.
+ * The header carries the tile layout and the sampling, which every piece must share.
+ */
+
+constexpr char RT3PART_MAGIC[8] = {'R', 'T', '3', 'P', 'A', 'R', 'T', '\0'};
+constexpr uint32_t RT3PART_VERSION = 1;
+constexpr uint32_t RT3PART_BYTE_ORDER = 0x01020304;
+
+struct RT3PartHeader {
+    char magic[8];          //!< Always RT3PART_MAGIC.
+    uint32_t version;       //!< Format version, RT3PART_VERSION.
+    uint32_t byte_order;    //!< RT3PART_BYTE_ORDER, as written by the renderer's machine.
+    int32_t width, height;  //!< Full resolution of the frame.
+    int32_t crop[4];        //!< Crop window in pixels: i0, i1, j0, j1.
+    int32_t write_cropped;  //!< Whether the final image is just the crop window.
+    int32_t image_type;     //!< `Film::image_type_e` of the final image.
+    int32_t tile_size;      //!< Side of the tiles the crop window is split into.
+    int32_t total_tiles;    //!< # of tiles in the frame.
+    int32_t spp, adaptive, min_spp;
+    float max_variance;
+    uint32_t n_tiles;       //!< # of tiles in this file.
+    uint32_t name_length;   //!< Length of the image file name that follows the header.
+};
+
+/// The contents of a `.rt3part` file.
+struct PartialImage {
+    RT3PartHeader header;
+    std::string filename;   //!< Where the final image goes.
+    vector<int> tiles;      //!< Ids of the tiles in this piece.
+    vector<float> rgb;      //!< Colors of the tiles' pixels, tile after tile.
+
+    Film::PixelWindow crop() const {
+        return Film::PixelWindow{ header.crop[0], header.crop[1], header.crop[2], header.crop[3] };
+    }
+
+    /// Whether `other` is a piece of the same frame: same image, tile layout and sampling.
+    bool same_frame(const PartialImage &other) const;
+};
+
+/// Writes the tiles `tiles` of `film`, whose crop window is split in tiles of `tile_size`.
+bool save_partial_image( const std::string &filename, const Film &film, int tile_size, const vector<int> &tiles );
+
+bool load_partial_image( const std::string &filename, PartialImage &part );
+
+}
+
+#endif
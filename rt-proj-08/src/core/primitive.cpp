@@ -2,17 +2,61 @@
 
 namespace rt3 {
 
+namespace {
+
+/// Surfels left over by earlier traversals on this thread, for Candidate to reuse.
+thread_local vector<shared_ptr<Surfel>> spare_surfels;
+
+/// Where an aggregate's children store their hits, before the closest is swapped into the
+/// caller's `isect`. It takes a spare Surfel and gives one back, so a ray does not
+/// allocate for every node it finds hits in.
+struct Candidate {
+    shared_ptr<Surfel> isect;
+
+    Candidate() {
+        if(!spare_surfels.empty()) {
+            isect = std::move(spare_surfels.back());
+            spare_surfels.pop_back();
+        }
+    }
+    ~Candidate() {
+        if(isect != nullptr && isect.use_count() == 1) spare_surfels.push_back(std::move(isect));
+    }
+};
+
+}
+
+void Primitive::intersect_packet( const RayPacket& rays, uint32_t mask, shared_ptr<Surfel> *isect ) const {
+    for(int k = 0; k < RayPacket::SIZE; ++k) {
+        if(!(mask & (1u << k))) continue;
+        shared_ptr<Surfel> hit;
+        if(intersect(rays.rays[k], hit) && (isect[k] == nullptr || hit->time < isect[k]->time)) {
+            isect[k] = hit;
+        }
+    }
+}
+
+uint32_t Primitive::intersect_packet_p( const RayPacket& rays, uint32_t mask ) const {
+    uint32_t blocked = 0;
+    for(int k = 0; k < RayPacket::SIZE; ++k) {
+        if((mask & (1u << k)) && intersect_p(rays.rays[k], rays.t_max[k])) blocked |= 1u << k;
+    }
+    return blocked;
+}
+
 bool PrimList::intersect(const Ray &r, shared_ptr<Surfel> &isect ) const {
-    shared_ptr<Surfel> currIsect(nullptr);
+    Candidate curr;
+    bool hit = false;
     for(auto &prim : primitives) {
-        if(prim->intersect(r, currIsect)) {
-            if(isect == nullptr || currIsect->time < isect->time){
-                isect = currIsect;
-                isect->primitive = std::dynamic_pointer_cast<GeometricPrimitive>(prim);
+        if(prim->intersect(r, curr.isect)) {
+            if(!hit || curr.isect->time < isect->time){
+                // The old closest hit becomes the next candidate.
+                std::swap(isect, curr.isect);
+                hit = true;
             }
         }
     }
-    return (isect != nullptr);
+    return hit;
 }
 
 bool PrimList::intersect_p(const Ray& r, real_type maxT ) const {
@@ -25,6 +69,7 @@ bool PrimList::intersect_p(const Ray& r, real_type maxT ) const {
 GeometricPrimitive::GeometricPrimitive(std::shared_ptr<Material> mat, std::unique_ptr<Shape> &&s) :
 	 	PrimitiveBounds(s->computeBounds()),
 		material(mat), 
+		material_id(mat ? mat->id : 0),
 		shape(std::move(s)) {}
 
 bool GeometricPrimitive::intersect_p( const Ray& r, real_type maxT  ) const {
@@ -35,8 +80,7 @@ bool GeometricPrimitive::intersect(const Ray &r, shared_ptr<Surfel> &isect ) con
     /* std::cout << "oi" << std::endl;
     return shape->intersect(r, isect); */
     if(shape->intersect(r, isect)){
-        auto shared_this = shared_ptr<const GeometricPrimitive>(shared_from_this());
-        isect->primitive = shared_this;
+        isect->material_id = material_id;
         return true;
     } else {
         return false; 
@@ -60,17 +104,50 @@ bool BVHAccel::intersect(const Ray &r, shared_ptr<Surfel> &isect ) const {
     pair<real_type, real_type> t;
     if(!bound_box.intersect_box(r, t)) return false;
 
-    shared_ptr<Surfel> currIsect(nullptr);
+    Candidate curr;
+    bool hit = false;
 
     for(auto &prim : primitives) {   
-        if(prim->intersect(r, currIsect)) {
-            if(isect == nullptr || currIsect->time < isect->time) {
-                isect = currIsect;
+        if(prim->intersect(r, curr.isect)) {
+            if(!hit || curr.isect->time < isect->time) {
+                std::swap(isect, curr.isect);
+                hit = true;
             }
         }
     }
 
-    return (isect != nullptr);
+    return hit;
+}
+
+void BVHAccel::intersect_packet(const RayPacket& rays, uint32_t mask, shared_ptr<Surfel> *isect) const {
+    uint32_t active = rays.intersect_box(bound_box, mask);
+    if(active == 0) return;
+
+    // Coherence broke down: tracing the few remaining rays one by one is cheaper.
+    if(active_lanes(active) < MIN_PACKET_LANES) {
+        Primitive::intersect_packet(rays, active, isect);
+        return;
+    }
+
+    for(auto &prim : primitives) {
+        prim->intersect_packet(rays, active, isect);
+    }
+}
+
+uint32_t BVHAccel::intersect_packet_p(const RayPacket& rays, uint32_t mask) const {
+    uint32_t active = rays.intersect_box_p(bound_box, mask);
+    if(active == 0) return 0;
+
+    if(active_lanes(active) < MIN_PACKET_LANES) {
+        return Primitive::intersect_packet_p(rays, active);
+    }
+
+    uint32_t blocked = 0;
+    for(auto &prim : primitives) {
+        blocked |= prim->intersect_packet_p(rays, active & ~blocked);
+        if((active & ~blocked) == 0) break;
+    }
+    return blocked;
 }
 
 std::shared_ptr<BVHAccel> BVHAccel::build(vector<std::shared_ptr<PrimitiveBounds>> &&prim, int primsPerLeaf) {
@@ -111,5 +188,25 @@ std::shared_ptr<BVHAccel> BVHAccel::build(vector<std::shared_ptr<PrimitiveBounds
     return tree[0];
 }
 
+const Primitive* LazyPrimitive::geometry() const {
+    std::call_once(once, [this]() {
+        primitive = loader();
+        loaded.store(true, std::memory_order_release);
+    });
+    return primitive.get();
+}
 
-}
\ No newline at end of file
+bool LazyPrimitive::intersect_p( const Ray& r, real_type maxT ) const {
+    if(!bound_box.intersect_p(r, maxT)) return false;
+    const Primitive *g = geometry();
+    return g && g->intersect_p(r, maxT);
+}
+
+bool LazyPrimitive::intersect(const Ray &r, shared_ptr<Surfel> &isect ) const {
+    pair<real_type, real_type> t;
+    if(!bound_box.intersect_box(r, t)) return false;
+    const Primitive *g = geometry();
+    return g && g->intersect(r, isect);
+}
+
+}
@@ -7,14 +7,27 @@
 #include "shape.h"
 #include "material.h"
 #include "bounds.h"
+#include "ray_packet.h"
+
+#include <atomic>
+#include <functional>
+#include <mutex>
 
 namespace rt3{
 
 class Primitive {
 public:
 	virtual ~Primitive(){};
+	/// Closest hit of `r`, stored in `isect`. A Surfel `isect` already points to is only scratch,
+	/// overwritten (see store_hit()) when nothing else holds it; `isect` is the hit only if this returns true.
 	virtual bool intersect( const Ray& r, std::shared_ptr<Surfel> &isect ) const = 0;
 	virtual bool intersect_p( const Ray& r, real_type maxT ) const = 0;
+	/// Intersects the active lanes of a packet; `isect[k]` keeps the closest hit of lane k.
+	/// By default every lane is traced on its own.
+	virtual void intersect_packet( const RayPacket& rays, uint32_t mask, std::shared_ptr<Surfel> *isect ) const;
+	/// Lanes of `mask` blocked before their `RayPacket::t_max`; the shadow ray version of
+	/// intersect_packet(). By default every lane is traced on its own.
+	virtual uint32_t intersect_packet_p( const RayPacket& rays, uint32_t mask ) const;
 };
 
 class PrimitiveBounds : public Primitive {
@@ -53,9 +66,10 @@ public:
 
 };
 
-class GeometricPrimitive : public PrimitiveBounds, public std::enable_shared_from_this<GeometricPrimitive>{
+class GeometricPrimitive : public PrimitiveBounds {
 public:
 	std::shared_ptr<Material> material;
+	int material_id; //!< `material`'s id, copied to the hits.
 	std::unique_ptr<Shape> shape;
 
 	GeometricPrimitive(std::shared_ptr<Material> mat, std::unique_ptr<Shape> &&s);
@@ -79,9 +93,45 @@ public:
 
     bool intersect(const Ray& r, std::shared_ptr<Surfel>& isect) const override;
 
+    /// The whole packet goes down the tree while enough lanes stay inside the nodes' boxes.
+    void intersect_packet(const RayPacket& rays, uint32_t mask, std::shared_ptr<Surfel> *isect) const override;
+
+    /// Same for shadow rays; lanes drop out as soon as they are blocked.
+    uint32_t intersect_packet_p(const RayPacket& rays, uint32_t mask) const override;
+
+    /// Below this many active lanes, a packet is split into single rays.
+    static constexpr int MIN_PACKET_LANES = 3;
+
     static std::shared_ptr<BVHAccel> build(vector<std::shared_ptr<PrimitiveBounds>> &&prim, int primsPerLeaf = 1);
 };
 
+/// Stand-in for a heavy piece of geometry, known only by its bounding box.
+/// The real primitive is built by `loader` the first time a ray enters the box;
+/// concurrent callers wait for that single build.
+class LazyPrimitive : public PrimitiveBounds {
+public:
+	using Loader = std::function<std::shared_ptr<Primitive>()>;
+
+	LazyPrimitive(Bounds3f bb, Loader &&load) : PrimitiveBounds(bb), loader(std::move(load)) {}
+
+	~LazyPrimitive(){};
+
+	bool intersect_p( const Ray& r, real_type maxT ) const override;
+
+	bool intersect( const Ray& r, std::shared_ptr<Surfel> &isect ) const override;
+
+	/// Tells whether the geometry has been built already.
+	bool is_loaded() const { return loaded.load(std::memory_order_acquire); }
+
+private:
+	/// Builds the geometry, once. Null when the loader could not make it: the proxy is then never hit.
+	const Primitive* geometry() const;
+
+	Loader loader;
+	mutable std::once_flag once;
+	mutable std::shared_ptr<Primitive> primitive;
+	mutable std::atomic<bool> loaded{ false };
+};
 
 } // namespace rt3
 
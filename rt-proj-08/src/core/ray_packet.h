@@ -0,0 +1,80 @@
+#ifndef RAY_PACKET_H
+#define RAY_PACKET_H
+
+#include <cstdint>
+
+#include "ray.h"
+#include "bounds.h"
+
+namespace rt3 {
+
+/// A small bundle of coherent rays, stored both as `Ray`s and in SoA form for box tests.
+/// Lanes are selected by bit masks: bit k set means lane k is active.
+struct RayPacket {
+    static constexpr int SIZE = 8;
+    static constexpr uint32_t ALL = (1u << SIZE) - 1;
+
+    Ray rays[SIZE];
+
+    real_type ox[SIZE], oy[SIZE], oz[SIZE];          //!< Origins.
+    real_type inv_dx[SIZE], inv_dy[SIZE], inv_dz[SIZE]; //!< Reciprocal directions, as in Bounds3f::intersect_box().
+    real_type t_max[SIZE];                              //!< Shadow rays: where the occlusion test stops.
+
+    void set(int k, const Ray &r) {
+        rays[k] = r;
+        ox[k] = r.o[0]; oy[k] = r.o[1]; oz[k] = r.o[2];
+        inv_dx[k] = inv(r.d[0]); inv_dy[k] = inv(r.d[1]); inv_dz[k] = inv(r.d[2]);
+        t_max[k] = r.t_max;
+    }
+
+    /// Lanes of `mask` whose rays pass through `box`; same test as Bounds3f::intersect_box().
+    uint32_t intersect_box(const Bounds3f &box, uint32_t mask) const {
+        bool hit[SIZE];
+        // Every lane is tested, so the compiler can vectorize the loop; the mask is applied after.
+        for(int k = 0; k < SIZE; ++k) {
+            real_type t_near, t_far;
+            slab(box, k, t_near, t_far);
+            hit[k] = t_near < t_far;
+        }
+        return to_mask(hit) & mask;
+    }
+
+    /// Lanes of `mask` whose rays reach `box` before `t_max`; same test as Bounds3f::intersect_p().
+    uint32_t intersect_box_p(const Bounds3f &box, uint32_t mask) const {
+        bool hit[SIZE];
+        for(int k = 0; k < SIZE; ++k) {
+            real_type t_near, t_far;
+            slab(box, k, t_near, t_far);
+            // The first crossing in front of the origin must come before t_max.
+            real_type t = (t_near > 0) ? t_near : t_far;
+            hit[k] = t_near < t_far && t > 0 && t < t_max[k];
+        }
+        return to_mask(hit) & mask;
+    }
+
+private:
+    /// Where lane k enters and leaves the slabs of `box`.
+    void slab(const Bounds3f &box, int k, real_type &t_near, real_type &t_far) const {
+        real_type tx0 = (box.min_point[0] - ox[k]) * inv_dx[k], tx1 = (box.max_point[0] - ox[k]) * inv_dx[k];
+        real_type ty0 = (box.min_point[1] - oy[k]) * inv_dy[k], ty1 = (box.max_point[1] - oy[k]) * inv_dy[k];
+        real_type tz0 = (box.min_point[2] - oz[k]) * inv_dz[k], tz1 = (box.max_point[2] - oz[k]) * inv_dz[k];
+
+        t_near = std::max(std::max(std::min(tx0, tx1), std::min(ty0, ty1)), std::min(tz0, tz1));
+        t_far = std::min(std::min(std::max(tx0, tx1), std::max(ty0, ty1)), std::max(tz0, tz1));
+    }
+
+    static uint32_t to_mask(const bool (&hit)[SIZE]) {
+        uint32_t result = 0;
+        for(int k = 0; k < SIZE; ++k) result |= uint32_t(hit[k]) << k;
+        return result;
+    }
+
+    static real_type inv(real_type d) { return (d == 0) ? real_type(1e18) : real_type(1.0 / d); }
+};
+
+/// # of active lanes in `mask`.
+inline int active_lanes(uint32_t mask) { return __builtin_popcount(mask); }
+
+}
+
+#endif
@@ -0,0 +1,63 @@
+#include "ray_stream.h"
+#include "bounds.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace rt3 {
+
+namespace {
+
+/// Spreads the 10 low bits of `x` so that there are two zeros between consecutive bits.
+uint64_t spread_bits(uint32_t x) {
+    uint64_t v = x & 0x3ff;
+    v = (v | (v << 16)) & 0x030000ff;
+    v = (v | (v << 8)) & 0x0300f00f;
+    v = (v | (v << 4)) & 0x030c30c3;
+    v = (v | (v << 2)) & 0x09249249;
+    return v;
+}
+
+/// 30 bit Morton code of a point of the unit cube.
+uint64_t morton(real_type x, real_type y, real_type z) {
+    auto quantize = [](real_type v) { return uint32_t(std::min(std::max(v, real_type(0)), real_type(1)) * 1023); };
+    return (spread_bits(quantize(x)) << 2) | (spread_bits(quantize(y)) << 1) | spread_bits(quantize(z));
+}
+
+}
+
+void RayStream::sort_coherent() {
+    size_t n = size();
+    if(n < 2) return;
+
+    Bounds3f box;
+    for(const Point3f &p : o) box = Bounds3f::insert(box, Bounds3f(p, p));
+    Vector3f extent = box.max_point - box.min_point;
+    for(int a = 0; a < 3; ++a) extent[a] = (extent[a] > 0) ? 1 / extent[a] : 0;
+
+    vector<uint64_t> keys(n);
+    for(size_t k = 0; k < n; ++k) {
+        Vector3f cell = (o[k] - box.min_point) * extent;
+        uint64_t octant = (d[k][0] < 0) | ((d[k][1] < 0) << 1) | ((d[k][2] < 0) << 2);
+        keys[k] = (octant << 60)
+                | (morton(cell[0], cell[1], cell[2]) << 30)
+                | morton((d[k][0] + 1) / 2, (d[k][1] + 1) / 2, (d[k][2] + 1) / 2);
+    }
+
+    vector<int> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](int a, int b) { return keys[a] < keys[b]; });
+
+    RayStream sorted;
+    sorted.o.reserve(n);
+    sorted.d.reserve(n);
+    sorted.slot.reserve(n);
+    for(int k : order) {
+        sorted.o.push_back(o[k]);
+        sorted.d.push_back(d[k]);
+        sorted.slot.push_back(slot[k]);
+    }
+    *this = std::move(sorted);
+}
+
+}
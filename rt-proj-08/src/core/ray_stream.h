@@ -0,0 +1,71 @@
+#ifndef RAY_STREAM_H
+#define RAY_STREAM_H
+
+#include "ray.h"
+#include "color.h"
+
+namespace rt3 {
+
+/// A batch of rays in SoA form, one array per field; used by the wavefront integrators.
+struct RayStream {
+    vector<Point3f> o;
+    vector<Vector3f> d;
+    vector<int> slot; //!< Where the radiance the ray brings back goes (e.g. a pixel of the batch).
+
+    size_t size() const { return slot.size(); }
+    bool empty() const { return slot.empty(); }
+
+    void push(const Ray &r, int s) {
+        o.push_back(r.o);
+        d.push_back(r.d);
+        slot.push_back(s);
+    }
+
+    void clear() { o.clear(); d.clear(); slot.clear(); }
+
+    /// Reorders the rays so that rays going the same way from nearby origins are adjacent:
+    /// by direction octant, then by the Morton code of the origin's cell (in the stream's
+    /// bounding box), then by the Morton code of the quantized direction.
+    void sort_coherent();
+
+    /// Ray k; the direction is already normalized, so the constructor is skipped.
+    Ray ray(size_t k) const {
+        Ray r;
+        r.o = o[k];
+        r.d = d[k];
+        return r;
+    }
+};
+
+/// Shadow rays in SoA form. A ray adds `color` to its slot when nothing blocks it before `max_t`.
+struct ShadowStream {
+    vector<Point3f> o;
+    vector<Vector3f> d;
+    vector<real_type> max_t;
+    vector<int> slot;
+    vector<Color> color;
+
+    size_t size() const { return slot.size(); }
+
+    void push(const Ray &r, int s, const Color &c) {
+        o.push_back(r.o);
+        d.push_back(r.d);
+        max_t.push_back(r.t_max);
+        slot.push_back(s);
+        color.push_back(c);
+    }
+
+    void clear() { o.clear(); d.clear(); max_t.clear(); slot.clear(); color.clear(); }
+
+    Ray ray(size_t k) const {
+        Ray r;
+        r.o = o[k];
+        r.d = d[k];
+        r.t_max = max_t[k];
+        return r;
+    }
+};
+
+}
+
+#endif
@@ -115,6 +115,30 @@ struct RunningOptions {
   std::string outfile;                                             //!< output image file name.
   bool quick_render{ false };  //!< if true render image with 1/4 of the
                                //!< requested resolition.
+  bool ray_packets{ true };      //!< Trace primary rays in packets, when the integrator allows it.
+  int n_threads{ 0 };            //!< # of render threads; 0 means one per hardware thread.
+  size_t max_geometry_mem{ 0 };  //!< Cap, in bytes, on the resident mesh geometry; 0 means no cap.
+  real_type time_budget{ 0 };    //!< Seconds for a progressive render; 0 means a single pass.
+  int n_frames{ 0 };             //!< # of frames along the camera path; 0 means the scene's `frames`.
+  bool preview{ false };         //!< Render at 1/16, 1/4 and 1/2 of the resolution before the full one.
+  bool denoise{ false };         //!< Filter the image, guided by normal, albedo and depth, before writing it.
+  bool watch{ false };           //!< Stay resident and render again whenever a scene or mesh file changes.
+  bool resident{ false };        //!< Long-lived process (`--watch`, rt3d): keep the meshes' accelerators for the next scenes.
+  int x_res{ 0 }, y_res{ 0 };    //!< Image resolution; 0 means the scene's.
+  // Distributed rendering: each process renders a subset of the tiles into a `.rt3part` file.
+  int bucket{ 0 };               //!< With `n_buckets` > 0, render the tiles whose id % n_buckets == bucket.
+  int n_buckets{ 0 };            //!< # of buckets the tiles are dealt into; 0 means no bucketing.
+  int tile_first{ 0 };           //!< With `tile_last` > `tile_first`, render only tiles [tile_first, tile_last).
+  int tile_last{ 0 };
+
+  /// Whether this process renders only part of the frame.
+  bool partial_render() const { return n_buckets > 0 or tile_last > tile_first; }
+  /// Whether tile `id` is rendered by this process.
+  bool owns_tile(int id) const {
+    if (n_buckets > 0 and id % n_buckets != bucket) return false;
+    if (tile_last > tile_first and (id < tile_first or id >= tile_last)) return false;
+    return true;
+  }
 };
 
 struct ScreenWindow {
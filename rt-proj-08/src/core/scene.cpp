@@ -8,4 +8,12 @@ namespace rt3 {
     bool Scene::intersect_p(const Ray &r, real_type maxT ) const {
         return primitive->intersect_p(r, maxT);
     }
+
+    void Scene::intersect_packet(const RayPacket &rays, uint32_t mask, shared_ptr<Surfel> *isect) const {
+        primitive->intersect_packet(rays, mask, isect);
+    }
+
+    uint32_t Scene::intersect_packet_p(const RayPacket &rays, uint32_t mask) const {
+        return primitive->intersect_packet_p(rays, mask);
+    }
 }
\ No newline at end of file
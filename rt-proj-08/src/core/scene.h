@@ -7,7 +7,8 @@
 //#include "rt3.h"
 #include "primitive.h"
 #include "light.h"
-#include "light.h"
+#include "light_table.h"
+#include "material_table.h"
 
 namespace rt3 {
 class Scene {
@@ -15,9 +16,13 @@ class Scene {
         std::unique_ptr< Background > background; // The background object.
         std::shared_ptr<Primitive> primitive; // The scene graph of objects, acceleration structure.
         std::vector<shared_ptr<Light>> lights; // list of lights
+        LightTable light_table;  // `lights`, compiled for shading.
+        MaterialTable materials; // Parameters of the materials, by id.
 
-        Scene( std::shared_ptr<Primitive> &&prim, std::unique_ptr< Background > &&bkg, vector<shared_ptr<Light>> &&lghts)
-             : background(std::move(bkg)), primitive(std::move(prim)), lights(std::move(lghts))
+        Scene( std::shared_ptr<Primitive> &&prim, std::unique_ptr< Background > &&bkg, vector<shared_ptr<Light>> &&lghts,
+               MaterialTable &&mats )
+             : background(std::move(bkg)), primitive(std::move(prim)), lights(std::move(lghts)),
+               light_table(lights), materials(std::move(mats))
         {/* empty */}
 
         ~Scene() = default;
@@ -27,6 +32,12 @@ class Scene {
          * it doesn't calculate the intersection info.
          */
         bool intersect_p( const Ray& r, real_type maxT ) const;
+        /// Whether nothing blocks the shadow ray of `ls`, i.e. its light reaches the hit.
+        bool unoccluded( const LightSample& ls ) const { return !intersect_p(ls.shadow, ls.shadow.t_max); }
+        /// Closest hit of every active lane of a ray packet; see Primitive::intersect_packet().
+        void intersect_packet( const RayPacket& rays, uint32_t mask, std::shared_ptr<Surfel> *isect ) const;
+        /// Lanes of `mask` whose shadow rays are blocked; see Primitive::intersect_packet_p().
+        uint32_t intersect_packet_p( const RayPacket& rays, uint32_t mask ) const;
 };
 
 } // namespace rt3
@@ -16,9 +16,17 @@ public:
 	Vector3f n;       //!< The surface normal.
 	Vector3f wo;      //!< Outgoing direction of light, which is -ray.
 	float time; 	  // This was missing 
-	std::shared_ptr<const GeometricPrimitive> primitive=nullptr; //!< Pointer to the primitive.
+	int material_id = 0; //!< Of the primitive hit; see MaterialTable.
 
 };
 
+/// Stores a hit in `isect`. The Surfel it points to is overwritten when nothing else holds it,
+/// so a traversal that keeps finding hits does not allocate one per hit.
+template <typename... Args>
+inline void store_hit( std::shared_ptr<Surfel> &isect, Args&&... args ) {
+	if(isect.use_count() == 1) *isect = Surfel(std::forward<Args>(args)...);
+	else isect = std::make_shared<Surfel>(std::forward<Args>(args)...);
+}
+
 } // namespace rt3
 #endif // SURFEL_H
@@ -0,0 +1,76 @@
+#include "thread_pool.h"
+
+#include <system_error>
+#include <thread>
+
+namespace rt3 {
+
+WorkStealingPool::WorkStealingPool(int n_threads)
+: n_workers(n_threads > 0 ? n_threads : std::max(1u, std::thread::hardware_concurrency())),
+  queues(n_workers)
+{/*empty*/}
+
+bool WorkStealingPool::pop(int worker, size_t &task) {
+    Queue &q = queues[worker];
+    std::lock_guard<std::mutex> lock{q.mutex};
+    if(q.tasks.empty()) return false;
+    task = q.tasks.back();
+    q.tasks.pop_back();
+    return true;
+}
+
+bool WorkStealingPool::steal(int thief, size_t &task) {
+    // Start with the next worker, so that thieves don't all go after the same victim.
+    for(int k = 1; k < n_workers; ++k) {
+        Queue &q = queues[(thief + k) % n_workers];
+        std::lock_guard<std::mutex> lock{q.mutex};
+        if(q.tasks.empty()) continue;
+        task = q.tasks.front();
+        q.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingPool::work(int worker, const Task &task) {
+    size_t id;
+    // Tasks are never added while running, so empty deques everywhere mean we are done.
+    while(!failed && (pop(worker, id) || steal(worker, id))) {
+        try {
+            task(id, worker);
+        } catch(...) {
+            std::lock_guard<std::mutex> lock{error_mutex};
+            if(!error) error = std::current_exception();
+            failed = true;
+        }
+    }
+}
+
+void WorkStealingPool::run(size_t n_tasks, const Task &task) {
+    // Fill the deques back to front, so that each worker pops its tasks in increasing order.
+    for(size_t id = n_tasks; id-- > 0;) {
+        queues[id % n_workers].tasks.push_back(id);
+    }
+
+    failed = false;
+    error = nullptr;
+
+    vector<std::thread> threads;
+    for(int w = 1; w < n_workers; ++w) {
+        try {
+            threads.emplace_back(&WorkStealingPool::work, this, w, std::cref(task));
+        } catch(const std::system_error&) {
+            break; // Fewer threads: the others steal the tasks of the missing workers.
+        }
+    }
+    work(0, task);
+    for(auto &t : threads) t.join();
+
+    if(failed) {
+        // Leave the deques empty for the next run.
+        for(Queue &q : queues) q.tasks.clear();
+        std::rethrow_exception(error);
+    }
+}
+
+}
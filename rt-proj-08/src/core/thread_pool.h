@@ -0,0 +1,57 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+
+#include "rt3.h"
+
+namespace rt3 {
+
+/*!
+ * Runs a batch of independent tasks on a fixed number of threads.
+ *
+ * Every worker owns a deque of task ids, filled round-robin before the start.
+ * A worker takes tasks from the back of its own deque and, once it runs dry,
+ * steals from the front of the others'. Each deque has its own lock, so there
+ * is no lock shared by all workers.
+ */
+class WorkStealingPool {
+public:
+    /// Task body: `task(task_id, worker_id)`.
+    using Task = std::function<void(size_t, int)>;
+
+    /// \param n_threads # of workers; 0 means one per hardware thread.
+    explicit WorkStealingPool(int n_threads = 0);
+
+    int size() const { return n_workers; }
+
+    /// Runs `task` for every id in [0, n_tasks) and waits for all of them.
+    /// The calling thread works as worker 0. If a task throws, the tasks not started yet are
+    /// dropped and, once every worker is done, the first exception is thrown again here.
+    void run(size_t n_tasks, const Task &task);
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+
+    bool pop(int worker, size_t &task);
+    bool steal(int thief, size_t &task);
+    void work(int worker, const Task &task);
+
+    int n_workers;
+    vector<Queue> queues;
+
+    std::atomic<bool> failed{false}; //!< A task of the current run threw.
+    std::mutex error_mutex;
+    std::exception_ptr error;        //!< The first exception thrown by a task.
+};
+
+}
+
+#endif
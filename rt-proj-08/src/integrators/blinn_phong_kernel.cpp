@@ -0,0 +1,108 @@
+#include "blinn_phong_kernel.h"
+
+#include <cmath>
+
+namespace rt3 {
+
+namespace {
+
+real_type clamp01(real_type x) { return std::min(real_type(1), std::max(real_type(0), x)); }
+
+template <typename T>
+void pad(vector<T> &v, size_t n) { v.resize(n, T(0)); }
+
+}
+
+void GBuffer::clear() {
+    for(auto *v : { &px, &py, &pz, &nx, &ny, &nz, &vx, &vy, &vz, &time }) v->clear();
+    material.clear();
+    slot.clear();
+    n = 0;
+}
+
+void GBuffer::push(const Surfel &hit, const Vector3f &view, int s) {
+    if(px.size() > n) {
+        // The last gather() padded the arrays; drop the padding.
+        for(auto *v : { &px, &py, &pz, &nx, &ny, &nz, &vx, &vy, &vz, &time }) v->resize(n);
+        material.resize(n);
+        slot.resize(n);
+    }
+    px.push_back(hit.p.x); py.push_back(hit.p.y); pz.push_back(hit.p.z);
+    nx.push_back(hit.n.x); ny.push_back(hit.n.y); nz.push_back(hit.n.z);
+    vx.push_back(view.x); vy.push_back(view.y); vz.push_back(view.z);
+    time.push_back(hit.time);
+    material.push_back(hit.material_id);
+    slot.push_back(s);
+    ++n;
+}
+
+void GBuffer::gather(const MaterialTable &materials) {
+    size_t padded = (n + BLOCK - 1) / BLOCK * BLOCK;
+    for(auto *v : { &px, &py, &pz, &nx, &ny, &nz, &vx, &vy, &vz, &time }) pad(*v, padded);
+    pad(material, padded);  // Id 0: no material, black.
+    pad(slot, padded);
+
+    for(auto *v : { &kd_r, &kd_g, &kd_b, &ks_r, &ks_g, &ks_b, &glossiness }) v->resize(padded);
+    for(size_t k = 0; k < padded; ++k) {
+        const BlinnPhongParams &m = materials.blinn_phong(material[k]);
+        kd_r[k] = m.diffuse.r; kd_g[k] = m.diffuse.g; kd_b[k] = m.diffuse.b;
+        ks_r[k] = m.specular.r; ks_g[k] = m.specular.g; ks_b[k] = m.specular.b;
+        glossiness[k] = m.glossiness;
+    }
+}
+
+Surfel GBuffer::surfel(size_t k) const {
+    Surfel hit;
+    hit.p = Point3f{ px[k], py[k], pz[k] };
+    hit.n = Vector3f{ nx[k], ny[k], nz[k] };
+    hit.wo = -Vector3f{ vx[k], vy[k], vz[k] };
+    hit.time = time[k];
+    hit.material_id = material[k];
+    return hit;
+}
+
+void LightLanes::resize(size_t n) {
+    for(auto *v : { &L_r, &L_g, &L_b, &wx, &wy, &wz }) v->assign(n, 0);
+}
+
+void LightLanes::set(size_t k, const Color &L, const Vector3f &wi) {
+    L_r[k] = L.r; L_g[k] = L.g; L_b[k] = L.b;
+    wx[k] = wi.x; wy[k] = wi.y; wz[k] = wi.z;
+}
+
+void blinn_phong_block(const GBuffer &g, const LightLanes &light, size_t first,
+                       real_type *out_r, real_type *out_g, real_type *out_b) {
+    constexpr int B = GBuffer::BLOCK;
+    const real_type *nx = &g.nx[first], *ny = &g.ny[first], *nz = &g.nz[first];
+    const real_type *vx = &g.vx[first], *vy = &g.vy[first], *vz = &g.vz[first];
+    const real_type *kd_r = &g.kd_r[first], *kd_g = &g.kd_g[first], *kd_b = &g.kd_b[first];
+    const real_type *ks_r = &g.ks_r[first], *ks_g = &g.ks_g[first], *ks_b = &g.ks_b[first];
+    const real_type *gloss = &g.glossiness[first];
+    const real_type *L_r = &light.L_r[first], *L_g = &light.L_g[first], *L_b = &light.L_b[first];
+    const real_type *wx = &light.wx[first], *wy = &light.wy[first], *wz = &light.wz[first];
+
+    // Without the pragma GCC gives up on the loop; with it (and -fopenmp-simd) the lanes are
+    // computed 4 at a time, pow() through glibc's vector `powf` (libmvec).
+    #pragma omp simd
+    for(int k = 0; k < B; ++k) {
+        // Diffuse: max(0, n . -wi), on the clamped product of the colors.
+        real_type cos_d = std::max(real_type(0), -(nx[k] * wx[k] + ny[k] * wy[k] + nz[k] * wz[k]));
+        real_type r = clamp01(clamp01(kd_r[k] * L_r[k]) * cos_d);
+        real_type gg = clamp01(clamp01(kd_g[k] * L_g[k]) * cos_d);
+        real_type b = clamp01(clamp01(kd_b[k] * L_b[k]) * cos_d);
+
+        // Specular: half vector h = -normalize(view + wi); no term when the glossiness is 0.
+        real_type hx = vx[k] + wx[k], hy = vy[k] + wy[k], hz = vz[k] + wz[k];
+        real_type inv_len = 1 / std::sqrt(hx * hx + hy * hy + hz * hz);
+        real_type cos_s = std::max(real_type(0), -(nx[k] * hx + ny[k] * hy + nz[k] * hz) * inv_len);
+        // A select, not a branch, so that pow() is taken for every lane.
+        real_type spec = std::pow(cos_s, gloss[k]);
+        spec = (gloss[k] != 0) ? spec : real_type(0);
+
+        out_r[k] = clamp01(r + clamp01(clamp01(ks_r[k] * L_r[k]) * spec));
+        out_g[k] = clamp01(gg + clamp01(clamp01(ks_g[k] * L_g[k]) * spec));
+        out_b[k] = clamp01(b + clamp01(clamp01(ks_b[k] * L_b[k]) * spec));
+    }
+}
+
+}
@@ -0,0 +1,64 @@
+#ifndef BLINN_PHONG_KERNEL_H
+#define BLINN_PHONG_KERNEL_H
+
+#include "../core/surfel.h"
+#include "../core/light_table.h"
+#include "../core/material_table.h"
+
+namespace rt3 {
+
+/*!
+ * The hits of a wavefront batch in SoA form, for the deferred mode of `PingPongIntegrator`:
+ * visibility fills it, then the lights are shaded for BLOCK hits at a time.
+ * Every array is padded with black hits to a whole # of blocks.
+ */
+struct GBuffer {
+    static constexpr int BLOCK = 8; //!< Hits shaded at once by `blinn_phong_block()`.
+
+    vector<real_type> px, py, pz;   //!< Position.
+    vector<real_type> nx, ny, nz;   //!< Normal.
+    vector<real_type> vx, vy, vz;   //!< View direction: that of the ray that hit.
+    vector<real_type> time;         //!< Ray parameter of the hit; shadow rays stop relative to it.
+    vector<int> material;           //!< Material id.
+    vector<int> slot;               //!< Where the hit's color goes.
+
+    // Gathered from the `MaterialTable` by `gather()`.
+    vector<real_type> kd_r, kd_g, kd_b;
+    vector<real_type> ks_r, ks_g, ks_b;
+    vector<real_type> glossiness;
+
+    size_t size() const { return n; }
+    /// Size of the arrays: `size()` rounded up to whole blocks.
+    size_t padded_size() const { return px.size(); }
+
+    void clear();
+    void push(const Surfel &hit, const Vector3f &view, int s);
+    /// Pads the arrays and fills in the material parameters.
+    void gather(const MaterialTable &materials);
+
+    /// Hit k, as the lights sample it.
+    Surfel surfel(size_t k) const;
+
+private:
+    size_t n = 0;
+};
+
+/// One light as seen from every hit of a `GBuffer`, in SoA form; same padding.
+struct LightLanes {
+    vector<real_type> L_r, L_g, L_b;  //!< Radiance reaching the hit.
+    vector<real_type> wx, wy, wz;     //!< Direction the light travels in.
+
+    void resize(size_t n);
+    void set(size_t k, const Color &L, const Vector3f &wi);
+};
+
+/// Diffuse and specular terms of `light` for the hits [first, first + GBuffer::BLOCK) of `g`,
+/// clamped at every step as `Color` operations do, like the scalar `blinn_phong()`. The lanes
+/// are independent: the loop is an OpenMP `simd` loop (built with -fopenmp-simd), which GCC
+/// vectorizes whole, `pow()` included.
+void blinn_phong_block(const GBuffer &g, const LightLanes &light, size_t first,
+                       real_type *out_r, real_type *out_g, real_type *out_b);
+
+}
+
+#endif
@@ -1,19 +1,24 @@
 #include "flat.h"
-#include "../materials/flat.h"
 
 namespace rt3 {
-    std::optional<Color> FlatIntegrator::Li(const Ray& ray, const unique_ptr<Scene>& scene) const {
-        Color L(0,0,0); // The radiance
+    void FlatIntegrator::render(const unique_ptr<Scene>& scene) {
+        materials = &scene->materials;
+        SamplerIntegrator::render(scene);
+    }
+
+    std::optional<Color> FlatIntegrator::Li(const Ray& ray, const unique_ptr<Scene>& scene, shared_ptr<Surfel> *primary) const {
         // Find closest ray intersection or return background radiance.
         shared_ptr<Surfel> isect; // Intersection information.
         if (!scene->intersect(ray, isect)) {
             return {}; // empty object.
         }
-        // Some form of determining the incoming radiance at the ray's origin.
-        // Polymorphism in action.
-        shared_ptr<FlatMaterial> fm = std::dynamic_pointer_cast<FlatMaterial>( isect->primitive->get_material() );
-        // Assign diffuse color to L.
-        return fm->get_color();
+        if (primary) *primary = isect;
+        return shade_hit(ray, isect);
+    }
+
+    Color FlatIntegrator::shade_hit(const Ray&, const shared_ptr<Surfel>& isect) const {
+        // The material's color, from the scene's material table.
+        return materials->flat(isect->material_id);
     }
 
     FlatIntegrator* create_flat_integrator(unique_ptr<Camera> &&camera){
@@ -11,7 +11,14 @@ public:
 
     FlatIntegrator( unique_ptr<Camera> &&_camera ): SamplerIntegrator(std::move(_camera)) {}
 
-    std::optional<Color> Li(const Ray&, const unique_ptr<Scene>&) const override;
+    void render(const unique_ptr<Scene>&) override;
+    std::optional<Color> Li(const Ray&, const unique_ptr<Scene>&, shared_ptr<Surfel> *primary) const override;
+
+    bool shades_primary_hits() const override { return true; }
+    Color shade_hit(const Ray&, const shared_ptr<Surfel>&) const override;
+
+private:
+    const MaterialTable *materials = nullptr; //!< The scene's, set by render().
 };
 
 FlatIntegrator* create_flat_integrator(unique_ptr<Camera> &&camera);
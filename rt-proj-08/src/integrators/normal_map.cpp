@@ -3,12 +3,17 @@
 
 namespace rt3{
 
-std::optional<Color> NormalIntegrator::Li(const Ray& ray, const unique_ptr<Scene>& scene) const {
+std::optional<Color> NormalIntegrator::Li(const Ray& ray, const unique_ptr<Scene>& scene, shared_ptr<Surfel> *primary) const {
     shared_ptr<Surfel> isect; // Intersection information.
     if (!scene->intersect(ray, isect)) {
         return {}; // empty object.
     }
+    if (primary) *primary = isect;
 
+    return shade_hit(ray, isect);
+}
+
+Color NormalIntegrator::shade_hit(const Ray&, const shared_ptr<Surfel>& isect) const {
     // normalmente, ocorre a normalização da normal
     Point3f normal = glm::normalize(isect->n);
 
@@ -12,7 +12,10 @@ public:
     NormalIntegrator( unique_ptr<Camera> &&_camera ):
         SamplerIntegrator(std::move(_camera)){}
 
-    std::optional<Color> Li(const Ray&, const unique_ptr<Scene>&) const override;
+    std::optional<Color> Li(const Ray&, const unique_ptr<Scene>&, shared_ptr<Surfel> *primary) const override;
+
+    bool shades_primary_hits() const override { return true; }
+    Color shade_hit(const Ray&, const shared_ptr<Surfel>&) const override;
 };
 
 NormalIntegrator* create_normal_integrator(unique_ptr<Camera> &&);
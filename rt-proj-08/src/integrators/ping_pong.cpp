@@ -1,8 +1,13 @@
 #include "ping_pong.h"
 
-#include "../lights/ambient.h"
-#include "../materials/ping_pong.h"
-#include "../core/light.h"
+#include "blinn_phong_kernel.h"
+#include "../core/ray_stream.h"
+
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <mutex>
+#include <numeric>
 
 namespace rt3{
 
@@ -10,78 +15,456 @@ Vector3f calc_h(const Vector3f &viewDir, const Vector3f &lightDir){
     return -glm::normalize(viewDir + lightDir);
 }
 
-std::optional<Color> PingPongIntegrator::Li(const Ray& ray, const unique_ptr<Scene>& scene) const{
-    Color L{0,0,0};
+/// Diffuse and specular contribution of a light reaching the hit (normal `n`) from `lightDir`.
+Color blinn_phong(const BlinnPhongParams &material, const Vector3f &n, const Vector3f &viewDir,
+                  const Vector3f &lightDir, const Color &lightColor){
+    Color color;
+    {
+        real_type coef = std::max(real_type(0), glm::dot(n, -lightDir));
+        Color diffuseContrib = material.diffuse * lightColor * coef;
+        
+        color = color + diffuseContrib;
+    }
+    
+    if(material.glossiness){
+        auto h = calc_h(viewDir, lightDir);
 
-    auto temp_L = Li(ray, scene, 1);
+        real_type coef = std::max(real_type(0), glm::dot(n, h));
+        coef = pow(coef, material.glossiness);
+        Color specularContrib = material.specular * lightColor * coef;
 
-    if(temp_L.has_value()) {
-        return temp_L.value();
+        color = color + specularContrib;
     }
+    return color;
+}
 
-    return {};
+bool is_black(const Color &c){
+    return c.r == 0 && c.g == 0 && c.b == 0;
 }
 
-std::optional<Color> PingPongIntegrator::Li(const Ray& ray, const unique_ptr<Scene>& scene, int currRecurStep) const{
-    shared_ptr<Surfel> isect; // Intersection information.  
-    if (!scene->intersect(ray, isect)) {
-        return {};
-    } else {
-        if(glm::dot(isect->wo, isect->n) < 0) return Color{0.0, 0.0, 0.0};
+/// `c` scaled by `w`, per channel, without clamping (the Blinn-Phong terms clamp later).
+Color scaled(const Color &c, const real_type w[3]){
+    return Color{c.r * w[0], c.g * w[1], c.b * w[2]};
+}
 
-        shared_ptr<PingPongMaterial> material = std::dynamic_pointer_cast<PingPongMaterial>(isect->primitive->get_material());
-        
-        Color color;
-        for(auto &light : scene->lights){
-            if(typeid(*light) == typeid(AmbientLight)){
-                color = color + (light->color_int * material->ambient);
-            }else{
-                shared_ptr<LightLi> lightLi = std::dynamic_pointer_cast<LightLi>(light);
-
-                auto [lightColor, lightDir, visTester] = lightLi->sample_Li(isect);
-
-                if(visTester->unoccluded(scene, isect->n)){ 
-                    {
-                        real_type coef = std::max(real_type(0), glm::dot(isect->n, -lightDir));
-                        Color diffuseContrib = material->diffuse * lightColor * coef;
-                        
-                        color = color + diffuseContrib;
-                    }
-                    
-                    if(material->glossiness){
-                        auto h = calc_h(ray.d, lightDir);
+/// Tells which rays of `shadows` are blocked, tracing them RayPacket::SIZE at a time in the
+/// order of `order` (indices in `shadows`; stream order if empty).
+void trace_shadow_packets(const Scene &scene, const ShadowStream &shadows, const vector<int> &order, vector<bool> &blocked){
+    blocked.assign(shadows.size(), false);
+    for(size_t first = 0; first < shadows.size(); first += RayPacket::SIZE){
+        RayPacket packet;
+        int ids[RayPacket::SIZE];
+        uint32_t mask = 0;
+        int n = std::min(size_t(RayPacket::SIZE), shadows.size() - first);
+        for(int k = 0; k < n; ++k){
+            ids[k] = order.empty() ? first + k : order[first + k];
+            packet.set(k, shadows.ray(ids[k]));
+            mask |= 1u << k;
+        }
+        uint32_t hit = scene.intersect_packet_p(packet, mask);
+        for(int k = 0; k < n; ++k) blocked[ids[k]] = hit & (1u << k);
+    }
+}
 
-                        real_type coef = std::max(real_type(0), glm::dot(isect->n, h));
-                        coef = pow(coef, material->glossiness);
-                        Color specularContrib = material->specular * lightColor * coef;
+void PingPongIntegrator::pick_lights(const Surfel &isect, const BlinnPhongParams &material, vector<LightPick> &picks) const{
+    picks.clear();
+    if(!light_tree){
+        for(int k : direct_lights) picks.push_back(LightPick{k, {1, 1, 1}});
+        return;
+    }
 
-                        color = color + specularContrib;
-                    }
+    for(int k : light_tree->unbounded()) picks.push_back(LightPick{k, {1, 1, 1}});
+    Color ks = material.glossiness ? material.specular : Color{};
+    if(light_sampling.mode == light_sampling_e::TREE){
+        light_tree->cut(isect.p, isect.n, material.diffuse, ks, light_sampling.threshold, picks);
+    }else{
+        // The random numbers depend only on the hit, so renders are repeatable.
+        uint32_t seed = 0;
+        for(int c = 0; c < 3; ++c){
+            uint32_t bits;
+            std::memcpy(&bits, &isect.p[c], sizeof(bits));
+            seed = (seed ^ bits) * 0x9e3779b1u;
+        }
+        light_tree->sample(isect.p, isect.n, material.diffuse, ks, light_sampling.samples, seed, picks);
+    }
+}
+
+std::optional<Color> PingPongIntegrator::Li(const Ray& ray, const unique_ptr<Scene>& scene, shared_ptr<Surfel> *primary) const{
+    // Color and mirror coefficient of every hit along the path. Color operations clamp, so
+    // the hits are combined back to front once the path ends, as the recursion used to do.
+    thread_local vector<std::pair<Color, Color>> bounces;
+    bounces.clear();
+
+    Ray curr = ray;
+    Color throughput{1, 1, 1};
+    // Intersection information; each bounce overwrites the Surfel of the last one.
+    shared_ptr<Surfel> isect;
+    for(int depth = 1; ; ++depth){
+        if (!scene->intersect(curr, isect)) {
+            if(depth == 1) return {};
+            break;
+        }
+        if(depth == 1 && primary) *primary = isect;
+        if(glm::dot(isect->wo, isect->n) < 0) {
+            bounces.push_back({Color{0.0, 0.0, 0.0}, Color{}});
+            break;
+        }
+
+        const BlinnPhongParams &material = scene->materials.blinn_phong(isect->material_id);
+        const LightTable &lights = scene->light_table;
+
+        Color color = lights.ambient * material.ambient;
+        thread_local vector<LightPick> picks;
+        pick_lights(*isect, material, picks);
+        if(shadow_packets){
+            // Shade first, then trace the shadow rays of the lights that would add something.
+            thread_local ShadowStream shadows;
+            thread_local vector<bool> blocked;
+            shadows.clear();
+            for(const LightPick &pick : picks){
+                LightSample ls = lights.sample(pick.light, *isect);
+                Color contrib = blinn_phong(material, isect->n, curr.d, ls.wi, scaled(ls.L, pick.weight));
+                if(!is_black(contrib)) shadows.push(ls.shadow, 0, contrib);
+            }
+            trace_shadow_packets(*scene, shadows, {}, blocked);
+            for(size_t k = 0; k < shadows.size(); ++k){
+                if(!blocked[k]) color = color + shadows.color[k];
+            }
+        }else{
+            for(const LightPick &pick : picks){
+                LightSample ls = lights.sample(pick.light, *isect);
+
+                if(scene->unoccluded(ls)){ 
+                    color = color + blinn_phong(material, isect->n, curr.d, ls.wi, scaled(ls.L, pick.weight));
                 }
             }
         }
 
-        Vector3f new_dir = glm::normalize((ray.d) - 2 * (glm::dot(ray.d, isect->n))*isect->n);
-        Ray refl_ray = Ray(isect->p + new_dir * 0.001f, new_dir, 0.1);
+        throughput = throughput * material.mirror;
+        bool reflect = depth < maxRecursionSteps && !is_black(material.mirror)
+                    && std::max({throughput.r, throughput.g, throughput.b}) >= minThroughput;
+        bounces.push_back({color, material.mirror});
+        if(!reflect) break;
+
+        Vector3f new_dir = glm::normalize((curr.d) - 2 * (glm::dot(curr.d, isect->n))*isect->n);
+        curr = Ray(isect->p + new_dir * 0.001f, new_dir, 0.1);
+    }
+
+    // The last hit's own reflection was not traced (or missed), so it is left out.
+    Color L = bounces.back().first;
+    for(int k = int(bounces.size()) - 2; k >= 0; --k){
+        L = bounces[k].first + bounces[k].second * L;
+    }
+    return L;
+}
+
+void PingPongIntegrator::render(const unique_ptr<Scene>& scene){
+    direct_lights = scene->light_table.direct();
+
+    light_tree.reset();
+    if(light_sampling.mode != light_sampling_e::ALL){
+        light_tree = make_unique<LightTree>(scene->lights);
+        std::cout << "\t Light tree over " << light_tree->size() << " point and spot lights ("
+                  << light_tree->unbounded().size() << " others shaded as usual), ";
+        if(light_sampling.mode == light_sampling_e::TREE){
+            std::cout << "light cuts within " << 100 * light_sampling.threshold << "% per node.\n";
+        }else{
+            std::cout << light_sampling.samples << " random lights per hit.\n";
+        }
+    }
+
+    if(shadow_packets){
+        std::cout << "\t Shadow rays traced in packets of " << RayPacket::SIZE << ".\n";
+    }
+
+    if(mode == mode_e::RECURSIVE) SamplerIntegrator::render(scene);
+    else render_wavefront(scene);
+}
+
+namespace {
+
+/// Wavefront stages, in pipeline order.
+enum Stage { CAMERA, INTERSECT, SHADE, SHADOW, SORT, REFLECT, FILM, N_STAGES };
+const char *stage_names[N_STAGES] = { "camera rays", "intersect", "shade", "shadow rays", "sort", "reflections", "film" };
+
+/// Time spent in each stage and # of rays traced, summed over batches (and threads).
+struct WavefrontStats {
+    double ms[N_STAGES] = {};
+    size_t primary = 0, reflected = 0, shadow = 0;
+    size_t reflected_hits = 0; //!< Reflection rays that hit something.
 
-        if(currRecurStep < maxRecursionSteps){
-            auto temp_L = Li(refl_ray, scene, currRecurStep + 1);
+    void add(const WavefrontStats &other){
+        for(int s = 0; s < N_STAGES; ++s) ms[s] += other.ms[s];
+        primary += other.primary;
+        reflected += other.reflected;
+        reflected_hits += other.reflected_hits;
+        shadow += other.shadow;
+    }
+};
+
+/// Adds the time since the last call to `stage`.
+class StageClock {
+public:
+    explicit StageClock(WavefrontStats &stats) : stats(stats), last(std::chrono::steady_clock::now()) {}
+    void lap(Stage stage){
+        auto now = std::chrono::steady_clock::now();
+        stats.ms[stage] += std::chrono::duration<double, std::milli>(now - last).count();
+        last = now;
+    }
+private:
+    WavefrontStats &stats;
+    std::chrono::steady_clock::time_point last;
+};
+
+}
+
+void PingPongIntegrator::render_wavefront(const unique_ptr<Scene>& scene){
+    int w = camera->film->width();
+    int h = camera->film->height();
+
+    WavefrontStats total;
+    std::mutex stats_mutex;
+
+    bool deferred = (mode == mode_e::DEFERRED);
+    bool guides = camera->film->wants_guides();
+    string note = ", wavefront batches of " + std::to_string(WAVEFRONT_TILE * WAVEFRONT_TILE) + " pixels"
+                + (deferred ? ", deferred shading in blocks of " + std::to_string(GBuffer::BLOCK) : "")
+                + (sort_reflections ? ", sorted reflections" : "") + sampling_note();
+    render_passes(WAVEFRONT_TILE, note, [&](int i0, int i1, int j0, int j1) {
+        WavefrontStats stats;
+        StageClock clock{stats};
+        vector<CameraSample> samples;
+        // Adaptive sampling takes several rounds; each round is one wavefront.
+        while(next_samples(i0, i1, j0, j1, samples)) {
+            int n_primary = samples.size();
+
+            // One slot per hit along a path: the first n_primary are the camera samples, the others are
+            // added for every reflection. A slot holds the color of its hit, the hit's mirror
+            // coefficient, the path throughput up to it and the slot of the hit the reflection came from.
+            // Color operations clamp, so the slots are combined back to front, just as the
+            // recursive Li() does, instead of weighting each contribution by its path throughput.
+            vector<Color> L(n_primary), mirror(n_primary), throughput(n_primary, Color{1, 1, 1});
+            vector<int> parent(n_primary, -1);
+
+            RayStream rays, reflected;
+            for(int k = 0; k < n_primary; ++k) {
+                Point2i pixel = samples[k].pixel;
+                Point2f offset = sample_offset(pixel.x, pixel.y, samples[k].index, camera->film->m_sampling.spp);
+                rays.push(camera->generate_ray(pixel.x, pixel.y, offset), k);
+            }
+            stats.primary += rays.size();
+            clock.lap(CAMERA);
+
+            vector<int> survivors;
+            vector<shared_ptr<Surfel>> hits;
+            vector<LightPick> picks;
+            ShadowStream shadows;
+            vector<int> shadow_light, order; // Light of each shadow ray; the rays sorted by light.
+            vector<bool> blocked;
+            GBuffer gbuffer;
+            LightLanes lanes;
+            vector<Ray> light_rays;
+            vector<real_type> contrib_r, contrib_g, contrib_b;
+            for(int depth = 1; !rays.empty(); ++depth) {
+                // Intersect the whole stream; only the rays that hit something survive.
+                // hits[s] is the hit of survivor s. The Surfels are kept from depth to depth
+                // and overwritten, as is the one a ray that misses was handed.
+                survivors.clear();
+                for(size_t k = 0; k < rays.size(); ++k) {
+                    if(hits.size() == survivors.size()) hits.emplace_back();
+                    shared_ptr<Surfel> &isect = hits[survivors.size()];
+                    bool hit = scene->intersect(rays.ray(k), isect);
+                    if(depth == 1 && guides) add_guide(samples[rays.slot[k]].pixel, rays.ray(k), hit ? isect.get() : nullptr, scene);
+                    if(hit) {
+                        survivors.push_back(k);
+                    } else if(depth == 1) {
+                        int p = rays.slot[k];
+                        Point2f screen_coord{ float(samples[p].pixel.y)/float(w), float(samples[p].pixel.x)/float(h) };
+                        L[p] = scene->background->sampleXYZ(screen_coord);
+                    }
+                }
+                if(depth > 1) stats.reflected_hits += survivors.size();
+                clock.lap(depth == 1 ? INTERSECT : REFLECT);
+
+                // Shade the hits: ambient light right away, the other lights through shadow rays,
+                // mirrors through the reflection stream of the next depth.
+                shadows.clear();
+                shadow_light.clear();
+                reflected.clear();
+                gbuffer.clear();
+                for(size_t s = 0; s < survivors.size(); ++s) {
+                    const shared_ptr<Surfel> &isect = hits[s];
+                    if(glm::dot(isect->wo, isect->n) < 0) continue;
+
+                    int k = survivors[s];
+                    int slot = rays.slot[k];
+                    const Vector3f &dir = rays.d[k];
+                    const BlinnPhongParams &material = scene->materials.blinn_phong(isect->material_id);
+                    const LightTable &lights = scene->light_table;
+
+                    L[slot] = L[slot] + lights.ambient * material.ambient;
+                    if(deferred) {
+                        gbuffer.push(*isect, dir, slot);
+                    } else {
+                        pick_lights(*isect, material, picks);
+                        for(const LightPick &pick : picks){
+                            LightSample ls = lights.sample(pick.light, *isect);
+                            Color contrib = blinn_phong(material, isect->n, dir, ls.wi, scaled(ls.L, pick.weight));
+                            if(!is_black(contrib)){
+                                shadows.push(ls.shadow, slot, contrib);
+                                shadow_light.push_back(pick.light);
+                            }
+                        }
+                    }
+
+                    // Same termination as Li(): black mirrors and faint paths are not traced further.
+                    Color weight = throughput[slot] * material.mirror;
+                    if(depth < maxRecursionSteps && !is_black(material.mirror)
+                       && std::max({weight.r, weight.g, weight.b}) >= minThroughput){
+                        Vector3f new_dir = glm::normalize(dir - 2 * (glm::dot(dir, isect->n))*isect->n);
+                        mirror[slot] = material.mirror;
+                        reflected.push(Ray(isect->p + new_dir * 0.001f, new_dir, 0.1), L.size());
+                        L.emplace_back();
+                        mirror.emplace_back();
+                        throughput.push_back(weight);
+                        parent.push_back(slot);
+                    }
+                }
+                clock.lap(SHADE);
+
+                // Deferred: one light at a time over the whole G-buffer, in the order Li() adds them.
+                if(deferred) {
+                    gbuffer.gather(scene->materials);
+                    size_t n = gbuffer.size(), padded = gbuffer.padded_size();
+                    lanes.resize(padded);
+                    light_rays.resize(n);
+                    for(auto *v : { &contrib_r, &contrib_g, &contrib_b }) v->resize(padded);
+                    clock.lap(SHADE);
+
+                    for(int light : direct_lights) {
+                        for(size_t k = 0; k < n; ++k) {
+                            LightSample ls = scene->light_table.sample(light, gbuffer.surfel(k));
+                            lanes.set(k, ls.L, ls.wi);
+                            light_rays[k] = ls.shadow;
+                        }
+                        for(size_t first = 0; first < padded; first += GBuffer::BLOCK) {
+                            blinn_phong_block(gbuffer, lanes, first, &contrib_r[first], &contrib_g[first], &contrib_b[first]);
+                        }
+                        shadows.clear();
+                        for(size_t k = 0; k < n; ++k) {
+                            Color contrib{ contrib_r[k], contrib_g[k], contrib_b[k] };
+                            if(!is_black(contrib)) shadows.push(light_rays[k], gbuffer.slot[k], contrib);
+                        }
+                        clock.lap(SHADE);
+
+                        // The light's shadow rays, as one batch; they come from neighbouring hits.
+                        if(shadow_packets) trace_shadow_packets(*scene, shadows, {}, blocked);
+                        for(size_t k = 0; k < shadows.size(); ++k) {
+                            bool visible = shadow_packets ? !blocked[k] : !scene->intersect_p(shadows.ray(k), shadows.max_t[k]);
+                            if(visible) L[shadows.slot[k]] = L[shadows.slot[k]] + shadows.color[k];
+                        }
+                        stats.shadow += shadows.size();
+                        clock.lap(SHADOW);
+                    }
+                    shadows.clear();
+                }
+
+                if(shadow_packets) {
+                    // Rays towards the same light from neighbouring hits are nearly parallel,
+                    // so they make better packets than the rays of one hit towards every light.
+                    order.resize(shadows.size());
+                    std::iota(order.begin(), order.end(), 0);
+                    std::stable_sort(order.begin(), order.end(), [&](int a, int b){ return shadow_light[a] < shadow_light[b]; });
+                    trace_shadow_packets(*scene, shadows, order, blocked);
+                    for(size_t k = 0; k < shadows.size(); ++k) {
+                        if(!blocked[k]) L[shadows.slot[k]] = L[shadows.slot[k]] + shadows.color[k];
+                    }
+                } else {
+                    for(size_t k = 0; k < shadows.size(); ++k) {
+                        if(!scene->intersect_p(shadows.ray(k), shadows.max_t[k])) {
+                            L[shadows.slot[k]] = L[shadows.slot[k]] + shadows.color[k];
+                        }
+                    }
+                }
+                stats.shadow += shadows.size();
+                clock.lap(SHADOW);
 
-            if(temp_L.has_value()) {
-                color = color + material->mirror * temp_L.value();
+                // Adjacent pixels' reflections may go anywhere; sorting puts rays that
+                // traverse the same BVH nodes next to each other.
+                if(sort_reflections) reflected.sort_coherent();
+                clock.lap(SORT);
+
+                std::swap(rays, reflected);
+                stats.reflected += rays.size();
+            }
+
+            // Reflections always come after the hit they left from.
+            for(size_t c = L.size(); c-- > size_t(n_primary);) {
+                L[parent[c]] = L[parent[c]] + mirror[parent[c]] * L[c];
             }
+            for(int p = 0; p < n_primary; ++p) {
+                camera->film->add_sample( samples[p].pixel, L[p] );
+            }
+            clock.lap(FILM);
         }
 
+        std::lock_guard<std::mutex> lock{stats_mutex};
+        total.add(stats);
+    });
 
-        return color;
+    std::streamsize precision = std::cout.precision();
+    double sum = 0;
+    for(int s = 0; s < N_STAGES; ++s) sum += total.ms[s];
+    std::cout << "\t Wavefront: " << total.primary << " camera, " << total.reflected << " reflected and "
+              << total.shadow << " shadow rays. Time per stage (summed over threads):\n";
+    for(int s = 0; s < N_STAGES; ++s) {
+        std::cout << "\t   " << std::left << std::setw(12) << stage_names[s] << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(10) << total.ms[s] << " ms  (" << std::setw(5) << (sum > 0 ? 100 * total.ms[s] / sum : 0) << "%)\n";
+    }
+    if(total.reflected > 0) {
+        std::cout << "\t   Reflection rays: " << std::setprecision(1) << 100.0 * total.reflected_hits / total.reflected
+                  << "% hit, " << std::setprecision(2) << total.reflected / (1000 * std::max(total.ms[REFLECT], 1e-3))
+                  << " Mrays/s (" << (sort_reflections ? "sorted" : "unsorted") << ").\n";
     }
+    std::cout << std::defaultfloat << std::setprecision(precision);
 }
 
 
 PingPongIntegrator* create_ping_pong_integrator(const ParamSet & ps_integrator, unique_ptr<Camera> &&camera){
+    string mode_name = retrieve(ps_integrator, "mode", string{"recursive"});
+    PingPongIntegrator::mode_e mode = PingPongIntegrator::mode_e::RECURSIVE;
+    if(mode_name == "wavefront"){
+        mode = PingPongIntegrator::mode_e::WAVEFRONT;
+    }else if(mode_name == "deferred"){
+        mode = PingPongIntegrator::mode_e::DEFERRED;
+    }else if(mode_name != "recursive"){
+        RT3_WARNING("Unknown integrator mode \"" + mode_name + "\", using \"recursive\".");
+    }
+
+    PingPongIntegrator::LightSampling light_sampling;
+    string lights = retrieve(ps_integrator, "light_sampling", string{"all"});
+    if(lights == "tree"){
+        light_sampling.mode = PingPongIntegrator::light_sampling_e::TREE;
+    }else if(lights == "stochastic"){
+        light_sampling.mode = PingPongIntegrator::light_sampling_e::STOCHASTIC;
+    }else if(lights != "all"){
+        RT3_WARNING("Unknown light sampling \"" + lights + "\", using \"all\".");
+    }
+    light_sampling.threshold = std::max(real_type(0), retrieve(ps_integrator, "light_threshold", real_type(0.02)));
+    light_sampling.samples = std::max(1, retrieve(ps_integrator, "light_samples", int(1)));
+    if(mode == PingPongIntegrator::mode_e::DEFERRED && light_sampling.mode != PingPongIntegrator::light_sampling_e::ALL){
+        RT3_WARNING("Deferred shading goes over every light for the whole G-buffer; ignoring light_sampling \"" + lights + "\".");
+        light_sampling.mode = PingPongIntegrator::light_sampling_e::ALL;
+    }
+
     return new PingPongIntegrator(
         std::move(camera),
-        retrieve(ps_integrator, "depth", int(1))
+        retrieve(ps_integrator, "depth", int(1)),
+        retrieve(ps_integrator, "min_throughput", real_type(0.002)),
+        mode,
+        retrieve(ps_integrator, "sort_reflections", string{"true"}) == "true",
+        retrieve(ps_integrator, "shadow_packets", string{"false"}) == "true",
+        light_sampling
     );
 }
 
@@ -2,19 +2,69 @@
 #define PING_PONG_INT_H
 
 #include "../core/integrator.h"
+#include "../core/light_tree.h"
 
 namespace rt3{
 
 class PingPongIntegrator : public SamplerIntegrator {
+public:
+    /// How the point and spot lights that shade a hit are chosen.
+    enum class light_sampling_e : int {
+        ALL = 0,    //!< Every light, as always.
+        TREE,       //!< A light cut of the `LightTree`.
+        STOCHASTIC  //!< A few lights, picked at random from the `LightTree`.
+    };
+    /// How the image is rendered.
+    enum class mode_e : int {
+        RECURSIVE = 0, //!< One `Li()` call per camera ray.
+        WAVEFRONT,     //!< Batches of rays, stage by stage; see render_wavefront().
+        DEFERRED       //!< Wavefront batches whose hits go through a G-buffer and are shaded in SIMD blocks.
+    };
+    struct LightSampling {
+        light_sampling_e mode = light_sampling_e::ALL;
+        real_type threshold = 0.02f; //!< Tree mode: bound on each cut node, relative to the cut's total.
+        int samples = 1;             //!< Stochastic mode: # of lights per hit.
+    };
+
 private:
     const int maxRecursionSteps;
+    const real_type minThroughput; //!< Paths whose throughput falls below this stop bouncing.
+    const mode_e mode;
+    const bool sort_reflections; //!< Sort each batch's reflection rays by `RayStream::sort_coherent()`.
+    const bool shadow_packets; //!< Trace the shadow rays of a hit (or a wavefront batch) together, in ray packets.
+    const LightSampling light_sampling;
+
+    // Set up by render() for the scene's lights.
+    vector<int> direct_lights;  //!< Indices in `Scene::lights` of the lights that are not ambient.
+    unique_ptr<LightTree> light_tree; //!< Only outside ALL mode.
+
+    /// Lights to shade `isect` with, ambient ones aside, as `light_sampling` says.
+    void pick_lights(const Surfel &isect, const BlinnPhongParams &material, vector<LightPick> &picks) const;
+
+    /// Renders the image in batches of WAVEFRONT_TILE x WAVEFRONT_TILE rays: each batch is
+    /// intersected, shaded and traced stage by stage, with shadow and reflection rays in separate streams.
+    /// Reflection rays are deferred until the whole batch is shaded, and sorted before being traced.
+    /// In DEFERRED mode, the hits of each stage are written to a `GBuffer` first; then every light
+    /// is sampled for all of them, its shadow rays are traced as a batch, and its Blinn-Phong terms
+    /// are evaluated by `blinn_phong_block()`, GBuffer::BLOCK hits at a time.
+    void render_wavefront(const unique_ptr<Scene>&);
 public:
+    /// Side of the square batches of the wavefront pipeline.
+    static constexpr int WAVEFRONT_TILE = 64;
+
     ~PingPongIntegrator(){};
-    PingPongIntegrator( unique_ptr<Camera> &&_camera, int depth ):
-        SamplerIntegrator(std::move(_camera)), maxRecursionSteps(depth){}
+    PingPongIntegrator( unique_ptr<Camera> &&_camera, int depth, real_type min_throughput,
+                        mode_e mode, bool sort_reflections, bool shadow_packets, const LightSampling &light_sampling ):
+        SamplerIntegrator(std::move(_camera)), maxRecursionSteps(depth), minThroughput(min_throughput),
+        mode(mode), sort_reflections(sort_reflections), shadow_packets(shadow_packets),
+        light_sampling(light_sampling){}
+
+    void render(const unique_ptr<Scene>&) override;
 
-    std::optional<Color> Li(const Ray&, const unique_ptr<Scene>&) const override;
-    std::optional<Color> Li(const Ray&, const unique_ptr<Scene>&, int currRecurStep) const;
+    /// Follows the mirror bounces of the ray in a loop, up to `depth` hits. A path stops early
+    /// when it hits a black mirror or when its throughput (product of the mirror colors so far)
+    /// falls below `min_throughput` in every channel.
+    std::optional<Color> Li(const Ray&, const unique_ptr<Scene>&, shared_ptr<Surfel> *primary) const override;
 };
 
 
@@ -2,24 +2,13 @@
 
 namespace rt3{
 
-tuple<Color, Vector3f, unique_ptr<VisibilityTester>> DirectionalLight::sample_Li(const shared_ptr<Surfel>& hit){
-
-    Point3f position = hit->p + (direction * -min_dist);
-
-    shared_ptr<Surfel> lightSurfel = make_shared<Surfel>(
-        position, 
-        Vector3f(),
-        direction,
-        min_dist
-    );
-
-    VisibilityTester *visTester = new VisibilityTester(hit, lightSurfel);
+LightSample DirectionalLight::sample_Li(const Surfel& hit) const {
+    return sample(direction, color_int, min_dist, hit);
+}
 
-    return tuple<Color, Vector3f, unique_ptr<VisibilityTester>>{
-        color_int,
-        direction,
-        unique_ptr<VisibilityTester>(visTester),
-    };
+LightSample DirectionalLight::sample(const Vector3f &direction, const Color &L, real_type distance, const Surfel &hit){
+    Point3f position = hit.p + (direction * -distance);
+    return LightSample{ L, direction, distance, shadow_ray(hit, hit.n, position) };
 }
 
 DirectionalLight* create_directional_light( const ParamSet &ps, Bounds3f worldBox ){
@@ -12,8 +12,11 @@ public:
 
     DirectionalLight(const Color &c, const Vector3f &scl, const Vector3f &lightDirection, real_type dist=10):
         LightLi(c, scl), direction(glm::normalize(lightDirection)), min_dist(dist){}
-    
-    tuple<Color, Vector3f, unique_ptr<VisibilityTester>> sample_Li(const shared_ptr<Surfel>& hit) override;
+    LightSample sample_Li(const Surfel& hit) const override;
+
+    /// A directional light along `direction`, put `distance` away from `hit` for the shadow ray.
+    /// Shared with `LightTable`.
+    static LightSample sample(const Vector3f &direction, const Color &L, real_type distance, const Surfel &hit);
 
 };
 
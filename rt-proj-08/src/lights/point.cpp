@@ -2,24 +2,13 @@
 
 namespace rt3{
 
-tuple<Color, Vector3f, unique_ptr<VisibilityTester>> PointLight::sample_Li(const shared_ptr<Surfel>& hit){
-
-    Vector3f direction = hit->p - position;
-
-    shared_ptr<Surfel> lightSurfel = make_shared<Surfel>(
-        position, 
-        Vector3f(),
-        glm::normalize(direction),
-        glm::length(direction)
-    );
-
-    VisibilityTester *visTester = new VisibilityTester(hit, lightSurfel);
+LightSample PointLight::sample_Li(const Surfel& hit) const {
+    return sample(position, color_int, hit);
+}
 
-    return tuple<Color, Vector3f, unique_ptr<VisibilityTester>>{
-        color_int,
-        glm::normalize(direction),
-        unique_ptr<VisibilityTester>(visTester),
-    };
+LightSample PointLight::sample(const Point3f &position, const Color &I, const Surfel &hit){
+    Vector3f direction = hit.p - position;
+    return LightSample{ I, glm::normalize(direction), glm::length(direction), shadow_ray(hit, hit.n, position) };
 }
 
 PointLight* create_point_light( const ParamSet &ps ){
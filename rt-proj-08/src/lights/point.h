@@ -12,8 +12,10 @@ public:
     PointLight(const Color &c, const Vector3f &scl, const Point3f &pos):
         LightLi(c, scl), position(pos){}
 
-    
-    tuple<Color, Vector3f, unique_ptr<VisibilityTester>> sample_Li(const shared_ptr<Surfel>& hit) override;
+    LightSample sample_Li(const Surfel& hit) const override;
+
+    /// A point light at `position` of intensity `I`, as seen from `hit`; shared with `LightTable`.
+    static LightSample sample(const Point3f &position, const Color &I, const Surfel &hit);
 
 };
 
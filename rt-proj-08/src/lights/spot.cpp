@@ -2,36 +2,27 @@
 
 namespace rt3{
 
-tuple<Color, Vector3f, unique_ptr<VisibilityTester>> SpotlightLight::sample_Li(const shared_ptr<Surfel>& hit){
+LightSample SpotlightLight::sample_Li(const Surfel& hit) const {
+    return sample(position, lightDirection, color_int, cutoff, falloff, angleInterval, hit);
+}
 
-    Vector3f direction = hit->p - position;
-    real_type angleCos = glm::dot(lightDirection, glm::normalize(direction));
-    real_type angle = Degrees(acos(angleCos));
+LightSample SpotlightLight::sample(const Point3f &position, const Vector3f &axis, const Color &I,
+                                   real_type cutoff, real_type falloff, real_type interval, const Surfel &hit){
 
-    shared_ptr<Surfel> lightSurfel = make_shared<Surfel>(
-        position,  // p
-        Vector3f(),
-        glm::normalize(direction),
-        glm::length(direction)
-    );
+    Vector3f direction = hit.p - position;
+    real_type angleCos = glm::dot(axis, glm::normalize(direction));
+    real_type angle = Degrees(acos(angleCos));
 
-    
     Color finalColor;
     if(angle > cutoff){
         finalColor = {0,0,0};
     }else if(angle > falloff){
-        finalColor = color_int * pow(1 - ((angle - falloff) / angleInterval), 4);
+        finalColor = I * pow(1 - ((angle - falloff) / interval), 4);
     }else{
-        finalColor = color_int;
+        finalColor = I;
     }
 
-    VisibilityTester *visTester = new VisibilityTester(hit, lightSurfel);
-
-    return tuple<Color, Vector3f, unique_ptr<VisibilityTester>>{
-        finalColor,
-        glm::normalize(direction),
-        unique_ptr<VisibilityTester>(visTester),
-    };
+    return LightSample{ finalColor, glm::normalize(direction), glm::length(direction), shadow_ray(hit, hit.n, position) };
 }
 
 SpotlightLight* create_spotlight_light( const ParamSet &ps ){
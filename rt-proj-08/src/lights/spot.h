@@ -19,8 +19,12 @@ public:
             angleInterval = cutoff - falloff; 
         }
 
-    
-    tuple<Color, Vector3f, unique_ptr<VisibilityTester>> sample_Li(const shared_ptr<Surfel>& hit) override;
+    LightSample sample_Li(const Surfel& hit) const override;
+
+    /// A spotlight at `position` pointing along `axis`, as seen from `hit`; angles in degrees.
+    /// Shared with `LightTable`.
+    static LightSample sample(const Point3f &position, const Vector3f &axis, const Color &I,
+                              real_type cutoff, real_type falloff, real_type interval, const Surfel &hit);
 
 };
 
@@ -31,7 +31,29 @@ void usage(const char* msg = nullptr) {
             << "    --quick                    Reduces quality parameters to "
                "render image quickly.\n"
             << "    --outfile <filename>       Write the rendered image to "
-               "<filename>.\n\n";
+               "<filename>.\n"
+            << "    --resolution <W> <H>       Render at W x H pixels instead of the scene's\n"
+            << "                               resolution.\n"
+            << "    --preview                  Render at 1/16, 1/4 and 1/2 of the resolution, then\n"
+            << "                               the full one, writing the image after every pass.\n"
+            << "    --threads <N>              Render with N threads (default: one per core).\n"
+            << "    --no-packets               Trace every primary ray on its own.\n"
+            << "    --max-geometry-mem <MB>    Keep meshes out of core, paging in at most\n"
+            << "                               <MB> megabytes of triangles at a time. Meshes\n"
+            << "                               read from text files stay in memory as read;\n"
+            << "                               convert them to .rt3mesh to keep them out too.\n"
+            << "                               The backing file goes in $TMPDIR (or /tmp).\n"
+            << "    --time-budget <sec>        Render progressively, adding samples until\n"
+            << "                               <sec> seconds have passed.\n"
+            << "    --frames <N>               Render N frames along the scene's camera_path.\n"
+            << "    --denoise                  Filter the image before writing it, guided by the\n"
+            << "                               normal, albedo and depth of the camera rays' hits.\n"
+            << "    --watch                    Stay running, and render again whenever the scene\n"
+            << "                               file, one of its includes or a mesh file changes.\n"
+            << "    --bucket <i/N>             Render only the tiles whose id is i modulo N, into\n"
+            << "                               a .rt3part file for rt3-merge.\n"
+            << "    --tile-range <first> <last> Render only tiles [first, last), into a .rt3part\n"
+            << "                               file for rt3-merge.\n\n";
   exit(msg != nullptr ? 1 : 0);
 }
 
@@ -58,9 +80,82 @@ RunningOptions cli_parser(int argc, char* argv[]) {
       }
       // Get output image file name.
       opt.outfile = std::string{ argv[++i] };
+    } else if (option == "--resolution" or option == "-resolution") {
+      if (i + 2 >= argc) {
+        usage("missing values after --resolution argument");
+      }
+      opt.x_res = std::stoi(argv[++i]);
+      opt.y_res = std::stoi(argv[++i]);
+      if (opt.x_res < 1 or opt.y_res < 1) {
+        usage("--resolution must be at least 1 x 1");
+      }
     } else if (option == "--quickrender" or option == "-quickrender" or option == "-q"
                or option == "--quick" or option == "-quick") {
       opt.quick_render = true;
+    } else if (option == "--preview" or option == "-preview") {
+      opt.preview = true;
+    } else if (option == "--threads" or option == "-threads" or option == "-t") {
+      if (i + 1 == argc) {  // The option's argument is missing.
+        usage("missing value after --threads argument");
+      }
+      opt.n_threads = std::stoi(argv[++i]);
+      if (opt.n_threads < 1) {
+        usage("--threads must be at least 1");
+      }
+    } else if (option == "--no-packets" or option == "-no-packets") {
+      opt.ray_packets = false;
+    } else if (option == "--max-geometry-mem" or option == "-max-geometry-mem") {
+      if (i + 1 == argc) {  // The option's argument is missing.
+        usage("missing value after --max-geometry-mem argument");
+      }
+      real_type mb = std::stof(argv[++i]);
+      if (mb <= 0) {
+        usage("--max-geometry-mem must be positive");
+      }
+      opt.max_geometry_mem = static_cast<size_t>(mb * 1024 * 1024);
+    } else if (option == "--time-budget" or option == "-time-budget") {
+      if (i + 1 == argc) {  // The option's argument is missing.
+        usage("missing value after --time-budget argument");
+      }
+      opt.time_budget = std::stof(argv[++i]);
+      if (opt.time_budget <= 0) {
+        usage("--time-budget must be positive");
+      }
+    } else if (option == "--frames" or option == "-frames") {
+      if (i + 1 == argc) {  // The option's argument is missing.
+        usage("missing value after --frames argument");
+      }
+      opt.n_frames = std::stoi(argv[++i]);
+      if (opt.n_frames < 1) {
+        usage("--frames must be at least 1");
+      }
+    } else if (option == "--denoise" or option == "-denoise") {
+      opt.denoise = true;
+    } else if (option == "--watch" or option == "-watch") {
+      opt.watch = true;
+    } else if (option == "--bucket" or option == "-bucket") {
+      if (i + 1 == argc) {  // The option's argument is missing.
+        usage("missing value after --bucket argument");
+      }
+      std::string value{ argv[++i] };
+      auto slash = value.find('/');
+      if (slash == std::string::npos) {
+        usage("--bucket must be given as i/N");
+      }
+      opt.bucket = std::stoi(value.substr(0, slash));
+      opt.n_buckets = std::stoi(value.substr(slash + 1));
+      if (opt.n_buckets < 1 or opt.bucket < 0 or opt.bucket >= opt.n_buckets) {
+        usage("--bucket i/N needs 0 <= i < N");
+      }
+    } else if (option == "--tile-range" or option == "-tile-range") {
+      if (i + 2 >= argc) {  // The option's arguments are missing.
+        usage("missing values after --tile-range argument");
+      }
+      opt.tile_first = std::stoi(argv[++i]);
+      opt.tile_last = std::stoi(argv[++i]);
+      if (opt.tile_first < 0 or opt.tile_last <= opt.tile_first) {
+        usage("--tile-range needs 0 <= first < last");
+      }
     } else if (option == "--help" or option == "-help" or option == "-h") {
       usage();
     } else {
@@ -76,6 +171,13 @@ RunningOptions cli_parser(int argc, char* argv[]) {
       scene_file_ifs.close();
     }
   }  // for to traverse the argument list.
+  if (opt.partial_render() and opt.time_budget > 0) {
+    RT3_WARNING("With --time-budget, the processes of a distributed render may reach different "
+                "sample counts, and the tiles may not blend.");
+  }
+  if (opt.partial_render() and opt.denoise) {
+    RT3_WARNING("--denoise is ignored in a distributed render: each process only has its own tiles.");
+  }
   return opt;
 }
 
@@ -101,7 +203,11 @@ int main(int argc, char* argv[]) {
   // (3) Initialize the renderer engine and load a scene.
   // ================================================
   API::init_engine(opt);
-  API::run();
+  if (opt.watch) {
+    API::watch();  // Until the process is killed.
+  } else {
+    API::run();
+  }
   API::clean_up();
 
   RT3_MESSAGE("\n    Thanks for using RT3!\n\n");
@@ -0,0 +1,231 @@
+#include "geometry_cache.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+#include <unistd.h>
+
+#include "triangle.h"
+
+namespace rt3 {
+
+namespace {
+
+/// Splits `ids` (triangle ids) at the median centroid along the longest axis,
+/// until every range has at most `max_size` triangles. Ranges come out in spatial order.
+void split_clusters(vector<int>::iterator begin, vector<int>::iterator end, const vector<Point3f> &centroids,
+                    size_t max_size, vector<std::pair<size_t, size_t>> &ranges, vector<int>::iterator first) {
+    size_t n = end - begin;
+    if(n <= max_size) {
+        ranges.push_back({size_t(begin - first), n});
+        return;
+    }
+
+    Bounds3f box;
+    for(auto it = begin; it != end; ++it) {
+        box = Bounds3f::insert(box, Bounds3f(centroids[*it], centroids[*it]));
+    }
+    Vector3f extent = box.max_point - box.min_point;
+    int axis = (extent[0] > extent[1] && extent[0] > extent[2]) ? 0 : (extent[1] > extent[2]) ? 1 : 2;
+
+    auto mid = begin + n / 2;
+    std::nth_element(begin, mid, end, [&](int a, int b) { return centroids[a][axis] < centroids[b][axis]; });
+
+    split_clusters(begin, mid, centroids, max_size, ranges, first);
+    split_clusters(mid, end, centroids, max_size, ranges, first);
+}
+
+}
+
+GeometryCache::GeometryCache(size_t max_bytes)
+: max_bytes(max_bytes)
+{
+    // TMPDIR lets the file go on a larger disk than /tmp.
+    const char *tmpdir = std::getenv("TMPDIR");
+    string dir = (tmpdir != nullptr && *tmpdir != '\0') ? tmpdir : "/tmp";
+    string name = dir + "/rt3_geometry_XXXXXX";
+    int fd = mkstemp(&name[0]);
+    if(fd < 0) RT3_ERROR("Could not create the geometry cache file in \"" + dir + "\".");
+    ::close(fd);
+
+    path = name;
+    writer.open(path, std::ios::binary | std::ios::trunc);
+
+    identity = make_shared<vector<int>>(3 * CLUSTER_SIZE);
+    std::iota(identity->begin(), identity->end(), 0);
+}
+
+size_t GeometryCache::cluster_bytes(int n_triangles) {
+    size_t payload = 3 * (sizeof(Point3f) + sizeof(Normal3f));
+    // Each triangle has a Triangle and a GeometricPrimitive (plus their shared_ptr control blocks),
+    // and there is about one BVH node per triangle.
+    size_t objects = sizeof(Triangle) + sizeof(GeometricPrimitive) + sizeof(BVHAccel) + 4 * sizeof(shared_ptr<Primitive>);
+    return n_triangles * (payload + objects) + sizeof(TriangleMesh);
+}
+
+vector<shared_ptr<PrimitiveBounds>> GeometryCache::add_mesh(const TriangleMesh &mesh, const Transform &to_world,
+                                                            shared_ptr<Material> material) {
+    // The corners are placed in the world as they are read: the mesh itself is not copied.
+    bool moved = !to_world.IsIdentity();
+    auto position = [&](int corner) {
+        const Point3f &p = mesh.vertices[mesh.vertex_indices[corner]];
+        return moved ? to_world.apply_p(p) : p;
+    };
+    auto normal = [&](int corner) {
+        const Normal3f &n = mesh.normals[mesh.normal_indices[corner]];
+        return moved ? to_world.apply_n(n) : n;
+    };
+
+    vector<Point3f> centroids(mesh.n_triangles);
+    for(int t = 0; t < mesh.n_triangles; ++t) {
+        centroids[t] = (position(3 * t) + position(3 * t + 1) + position(3 * t + 2)) / real_type(3);
+    }
+
+    vector<int> ids(mesh.n_triangles);
+    std::iota(ids.begin(), ids.end(), 0);
+    vector<std::pair<size_t, size_t>> ranges;
+    split_clusters(ids.begin(), ids.end(), centroids, CLUSTER_SIZE, ranges, ids.begin());
+
+    vector<shared_ptr<PrimitiveBounds>> proxies;
+    vector<Point3f> positions;
+    vector<Normal3f> normals;
+    for(auto [start, n] : ranges) {
+        positions.clear();
+        normals.clear();
+        for(size_t k = start; k < start + n; ++k) {
+            for(int i = 0; i < 3; ++i) {
+                positions.push_back(position(3 * ids[k] + i));
+                normals.push_back(normal(3 * ids[k] + i));
+            }
+        }
+        // createBox() pads the box, so flat clusters still have some thickness.
+        Bounds3f box = Bounds3f::createBox(positions);
+
+        Cluster cluster;
+        cluster.offset = written;
+        cluster.n_triangles = static_cast<int>(n);
+        cluster.backface_cull = mesh.backface_cull;
+        cluster.material = material;
+        clusters.push_back(cluster);
+
+        writer.write(reinterpret_cast<const char*>(positions.data()), positions.size() * sizeof(Point3f));
+        writer.write(reinterpret_cast<const char*>(normals.data()), normals.size() * sizeof(Normal3f));
+        written += positions.size() * sizeof(Point3f) + normals.size() * sizeof(Normal3f);
+
+        proxies.push_back(make_shared<ClusterPrimitive>(box, shared_from_this(), clusters.size() - 1));
+    }
+
+    counters.n_clusters = clusters.size();
+    return proxies;
+}
+
+bool GeometryCache::finalize() {
+    // A full disk shows up here: a failed write leaves the stream bad.
+    bool ok = writer.good();
+    writer.close();
+    ok = ok && !writer.fail();
+    if(ok) file = MappedFile::open(path);
+    // The mapping keeps the data reachable; the name is not needed anymore.
+    std::remove(path.c_str());
+
+    slots = std::make_unique<Slot[]>(clusters.size());
+    return clusters.empty() || (ok && file != nullptr && file->size() == written);
+}
+
+shared_ptr<Primitive> GeometryCache::page_in(const Cluster &cluster) const {
+    size_t n_corners = 3 * cluster.n_triangles;
+    const char *payload = file->data() + cluster.offset;
+
+    vector<Point3f> positions(n_corners);
+    vector<Normal3f> normals(n_corners);
+    std::memcpy(positions.data(), payload, n_corners * sizeof(Point3f));
+    std::memcpy(normals.data(), payload + n_corners * sizeof(Point3f), n_corners * sizeof(Normal3f));
+
+    // The payload is already unindexed, so every cluster shares the same identity index buffer.
+    MeshBuffer<int> indices{identity->data(), n_corners, identity};
+    auto mesh = make_shared<TriangleMesh>(cluster.n_triangles, cluster.backface_cull, indices, indices,
+                                          MeshBuffer<Point3f>{std::move(positions)},
+                                          MeshBuffer<Normal3f>{std::move(normals)});
+
+    vector<shared_ptr<PrimitiveBounds>> prims;
+    prims.reserve(cluster.n_triangles);
+    for(Shape *shape : create_triangles(mesh)) {
+        prims.push_back(make_shared<GeometricPrimitive>(cluster.material, unique_ptr<Shape>(shape)));
+    }
+    return BVHAccel::build(std::move(prims));
+}
+
+shared_ptr<Primitive> GeometryCache::acquire(size_t id) {
+    Slot &slot = slots[id];
+    uint64_t now = epoch.load(std::memory_order_relaxed);
+    // Stamping only when the stamp changes keeps rays that hit the same clusters from
+    // writing to them over and over.
+    if(slot.last_use.load(std::memory_order_relaxed) != now) {
+        slot.last_use.store(now, std::memory_order_relaxed);
+    }
+    shared_ptr<Primitive> geometry = std::atomic_load(&slot.resident);
+    if(geometry != nullptr) return geometry;
+
+    auto start = std::chrono::steady_clock::now();
+
+    // Rays that miss the same cluster wait for the first one to page it in.
+    // Their wait counts as a stall too.
+    std::lock_guard<std::mutex> loading{slot.loading};
+    geometry = std::atomic_load(&slot.resident);
+    if(geometry != nullptr) {
+        std::lock_guard<std::mutex> lock{mutex};
+        counters.stall_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return geometry;
+    }
+
+    geometry = page_in(clusters[id]);
+
+    std::lock_guard<std::mutex> lock{mutex};
+    slot.last_use.store(epoch.fetch_add(1, std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_store(&slot.resident, geometry);
+    resident.push_back(id);
+    resident_bytes += cluster_bytes(clusters[id].n_triangles);
+    counters.page_ins++;
+    counters.peak_bytes = std::max(counters.peak_bytes, resident_bytes);
+
+    // The cluster just paged in is never evicted, even if it alone goes over the cap.
+    while(resident_bytes > max_bytes && resident.size() > 1) {
+        size_t stalest = 0;
+        for(size_t k = 1; k < resident.size(); ++k) {
+            if(resident[stalest] == id
+               || (resident[k] != id && slots[resident[k]].last_use < slots[resident[stalest]].last_use)) {
+                stalest = k;
+            }
+        }
+        size_t victim = resident[stalest];
+        resident[stalest] = resident.back();
+        resident.pop_back();
+        // A ray that loaded the geometry before this keeps it alive until it is done.
+        std::atomic_store(&slots[victim].resident, shared_ptr<Primitive>());
+        resident_bytes -= cluster_bytes(clusters[victim].n_triangles);
+        counters.evictions++;
+    }
+
+    counters.stall_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return geometry;
+}
+
+GeometryCache::Stats GeometryCache::stats() const {
+    std::lock_guard<std::mutex> lock{mutex};
+    return counters;
+}
+
+bool ClusterPrimitive::intersect_p( const Ray& r, real_type maxT ) const {
+    if(!bound_box.intersect_p(r, maxT)) return false;
+    return cache->acquire(id)->intersect_p(r, maxT);
+}
+
+bool ClusterPrimitive::intersect(const Ray &r, shared_ptr<Surfel> &isect ) const {
+    pair<real_type, real_type> t;
+    if(!bound_box.intersect_box(r, t)) return false;
+    return cache->acquire(id)->intersect(r, isect);
+}
+
+}
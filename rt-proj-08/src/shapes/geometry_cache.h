@@ -0,0 +1,121 @@
+#ifndef GEOMETRY_CACHE_H
+#define GEOMETRY_CACHE_H
+
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+#include "../core/primitive.h"
+#include "../core/mapped_file.h"
+#include "triangle_mesh.h"
+
+namespace rt3{
+
+/*!
+ * Out-of-core storage for triangle meshes.
+ *
+ * Meshes are split into spatial clusters of at most `CLUSTER_SIZE` triangles, whose
+ * vertices and normals are written to a temporary file. The file is memory mapped, and
+ * a cluster's triangles, primitives and BVH are only built ("paged in") when a ray
+ * reaches the cluster's box. Resident clusters are stamped with the page in count at their
+ * last use, and the stalest ones are evicted whenever their estimated size goes over the cap.
+ *
+ * Rays find resident clusters without taking a lock; a cluster is built by the first ray
+ * that misses it, while rays that need other clusters go on. The cache's mutex only
+ * guards the resident list and the eviction. An evicted cluster stays alive while a
+ * surfel or a ray still holds it.
+ *
+ * The cap covers what the cache builds. The meshes it is given are the caller's: with
+ * meshes read from text files they stay in memory too, while `.rt3mesh` files are only
+ * mapped, so the system can page them out.
+ */
+class GeometryCache : public std::enable_shared_from_this<GeometryCache> {
+public:
+    /// Largest # of triangles in a cluster.
+    static constexpr int CLUSTER_SIZE = 1024;
+
+    struct Stats {
+        size_t n_clusters = 0;
+        size_t page_ins = 0;
+        size_t evictions = 0;
+        size_t peak_bytes = 0; //!< Most geometry resident at once.
+        double stall_ms = 0;   //!< Time rays waited for clusters to be paged in.
+    };
+
+    /// \param max_bytes Memory cap for the resident clusters.
+    explicit GeometryCache(size_t max_bytes);
+
+    GeometryCache( const GeometryCache& ) = delete;
+    GeometryCache& operator=( const GeometryCache& ) = delete;
+
+    /// Splits `mesh`, placed in the world by `to_world`, into clusters and stores them;
+    /// returns one proxy per cluster. The cache must be owned by a `shared_ptr`, and
+    /// `finalize()` not called yet.
+    vector<shared_ptr<PrimitiveBounds>> add_mesh(const TriangleMesh &mesh, const Transform &to_world,
+                                                 shared_ptr<Material> material);
+
+    /// Closes the backing file and maps it. Call it once, after the last `add_mesh()`;
+    /// returns false if the file could not be written or mapped.
+    bool finalize();
+
+    /// Returns the cluster's geometry, paging it in if needed.
+    shared_ptr<Primitive> acquire(size_t cluster);
+
+    Stats stats() const;
+
+private:
+    struct Cluster {
+        uint64_t offset = 0; //!< Position of the payload in the backing file.
+        int n_triangles = 0;
+        bool backface_cull = false;
+        shared_ptr<Material> material;
+    };
+
+    /// Run time state of a cluster; made by `finalize()`.
+    struct Slot {
+        shared_ptr<Primitive> resident;     //!< Paged in geometry, or nullptr; read with `std::atomic_load`.
+        std::atomic<uint64_t> last_use{0};  //!< Value of `epoch` when a ray last needed the cluster.
+        std::mutex loading;                 //!< Held while the cluster is paged in.
+    };
+
+    /// Rough footprint of a paged in cluster: payload, triangles, primitives and BVH nodes.
+    static size_t cluster_bytes(int n_triangles);
+
+    shared_ptr<Primitive> page_in(const Cluster &cluster) const;
+
+    size_t max_bytes;
+    string path;               //!< Backing file, removed once mapped.
+    std::ofstream writer;      //!< Open until `finalize()`.
+    uint64_t written = 0;
+    shared_ptr<MappedFile> file;
+    shared_ptr<vector<int>> identity; //!< 0, 1, 2, ...; the index buffer of every cluster.
+
+    vector<Cluster> clusters;
+    std::unique_ptr<Slot[]> slots;
+    std::atomic<uint64_t> epoch{0}; //!< # of page ins so far.
+
+    mutable std::mutex mutex;  //!< Guards what follows.
+    vector<size_t> resident;   //!< Ids of the resident clusters.
+    size_t resident_bytes = 0;
+    Stats counters;
+};
+
+/// Stand-in for one cluster of a `GeometryCache`.
+class ClusterPrimitive : public PrimitiveBounds {
+public:
+    ClusterPrimitive(Bounds3f bb, shared_ptr<GeometryCache> cache, size_t id)
+    : PrimitiveBounds(bb), cache(std::move(cache)), id(id) {}
+
+    bool intersect_p( const Ray& r, real_type maxT ) const override;
+
+    bool intersect( const Ray& r, std::shared_ptr<Surfel> &isect ) const override;
+
+private:
+    shared_ptr<GeometryCache> cache;
+    size_t id;
+};
+
+}
+
+#endif
@@ -0,0 +1,412 @@
+#include "obj_reader.h"
+
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include "../core/mapped_file.h"
+#include "../core/thread_pool.h"
+
+namespace rt3 {
+
+namespace {
+
+/// Chunks smaller than this are not worth a thread of their own.
+constexpr size_t MIN_CHUNK_BYTES = 64 * 1024;
+
+/// One `v/vt/vn` corner of a face, as 0-based indices (-1 when absent).
+/// A relative index may resolve to -1 too, so absence is kept apart until the indices are checked.
+struct FaceCorner {
+    int v = -1, vt = -1, vn = -1;
+    bool has_vt = false, has_vn = false;
+};
+
+/// Everything parsed from a single chunk of the file.
+struct ObjChunk {
+    vector<Point3f> vertices;
+    vector<Normal3f> normals;
+    vector<Point2f> uvcoords;
+
+    vector<FaceCorner> corners; //!< Corners of all faces, in file order.
+    vector<int> face_sizes;     //!< # of corners of each face.
+    /// Positions in `corners` holding relative (negative) OBJ indices. They are
+    /// resolved against the chunk's first element and need the chunk's global offset.
+    vector<size_t> relative_v, relative_vt, relative_vn;
+
+    vector<FaceCorner> triangles; //!< Triangulated faces, 3 corners per triangle.
+
+    bool ok = true;
+    string error;
+};
+
+inline bool is_blank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+inline const char* skip_blanks(const char *p, const char *end) {
+    while(p < end && is_blank(*p)) ++p;
+    return p;
+}
+
+inline const char* next_line(const char *p, const char *end) {
+    const void *nl = std::memchr(p, '\n', end - p);
+    return nl ? static_cast<const char*>(nl) + 1 : end;
+}
+
+/// Reads a real number; `std::from_chars` doesn't accept a leading '+'.
+inline bool read_real(const char *&p, const char *end, real_type &value) {
+    p = skip_blanks(p, end);
+    if(p < end && *p == '+') ++p;
+    auto [ptr, ec] = std::from_chars(p, end, value);
+    if(ec != std::errc()) return false;
+    p = ptr;
+    return true;
+}
+
+/// Reads an integer, if there is one; returns false otherwise.
+inline bool read_int(const char *&p, const char *end, int &value) {
+    if(p < end && *p == '+') ++p;
+    auto [ptr, ec] = std::from_chars(p, end, value);
+    if(ec != std::errc()) return false;
+    p = ptr;
+    return true;
+}
+
+/// Converts an OBJ index into a 0-based one. Negative indices are relative to the
+/// elements read so far in this chunk and get recorded in `relative` for the merge step.
+inline int fix_index(int obj_idx, size_t n_read, vector<size_t> &relative, size_t pos) {
+    if(obj_idx > 0) return obj_idx - 1;
+    if(obj_idx == 0) return -1; // Not present.
+    relative.push_back(pos);
+    return static_cast<int>(n_read) + obj_idx;
+}
+
+void parse_chunk(const char *begin, const char *end, ObjChunk &chunk) {
+    int line_no = 0;
+
+    for(const char *line = begin; line < end; line = next_line(line, end)) {
+        ++line_no;
+        const char *p = skip_blanks(line, end);
+        if(p + 1 >= end || *p == '#' || *p == '\n') continue;
+
+        if(p[0] == 'v' && is_blank(p[1])) {
+            Point3f v;
+            p += 2;
+            if(!read_real(p, end, v.x) || !read_real(p, end, v.y) || !read_real(p, end, v.z)) {
+                chunk.ok = false;
+                chunk.error = "bad vertex at chunk line " + std::to_string(line_no);
+                return;
+            }
+            chunk.vertices.push_back(v);
+        } else if(p[0] == 'v' && p[1] == 'n' && p + 2 < end && is_blank(p[2])) {
+            Normal3f n;
+            p += 3;
+            if(!read_real(p, end, n.x) || !read_real(p, end, n.y) || !read_real(p, end, n.z)) {
+                chunk.ok = false;
+                chunk.error = "bad normal at chunk line " + std::to_string(line_no);
+                return;
+            }
+            chunk.normals.push_back(n);
+        } else if(p[0] == 'v' && p[1] == 't' && p + 2 < end && is_blank(p[2])) {
+            Point2f uv{0, 0};
+            p += 3;
+            if(!read_real(p, end, uv.x)) {
+                chunk.ok = false;
+                chunk.error = "bad texture coordinate at chunk line " + std::to_string(line_no);
+                return;
+            }
+            // The second coordinate is optional.
+            const char *q = p;
+            if(!read_real(q, end, uv.y)) uv.y = 0;
+            chunk.uvcoords.push_back(uv);
+        } else if(p[0] == 'f' && is_blank(p[1])) {
+            int n_corners = 0;
+            p += 2;
+            while(true) {
+                p = skip_blanks(p, end);
+                int v = 0, vt = 0, vn = 0;
+                if(!read_int(p, end, v)) break;
+                if(p < end && *p == '/') {
+                    ++p;
+                    read_int(p, end, vt); // May be empty, as in "v//vn".
+                    if(p < end && *p == '/') {
+                        ++p;
+                        read_int(p, end, vn);
+                    }
+                }
+                size_t pos = chunk.corners.size();
+                FaceCorner c;
+                c.v = fix_index(v, chunk.vertices.size(), chunk.relative_v, pos);
+                c.vt = fix_index(vt, chunk.uvcoords.size(), chunk.relative_vt, pos);
+                c.vn = fix_index(vn, chunk.normals.size(), chunk.relative_vn, pos);
+                c.has_vt = vt != 0;
+                c.has_vn = vn != 0;
+                chunk.corners.push_back(c);
+                n_corners++;
+            }
+            chunk.face_sizes.push_back(n_corners);
+        }
+        // Any other statement (g, o, s, usemtl, mtllib, l, ...) is ignored.
+    }
+}
+
+/// Point-in-polygon test, as in tinyobjloader.
+int pnpoly(int nvert, const real_type *vertx, const real_type *verty, real_type testx, real_type testy) {
+    int c = 0;
+    for(int i = 0, j = nvert - 1; i < nvert; j = i++) {
+        if(((verty[i] > testy) != (verty[j] > testy))
+           && (testx < (vertx[j] - vertx[i]) * (testy - verty[i]) / (verty[j] - verty[i]) + vertx[i]))
+            c = !c;
+    }
+    return c;
+}
+
+/*!
+ * Splits a polygon into triangles by ear clipping on its dominant plane.
+ * This mirrors tinyobjloader's triangulation, so both readers produce the same
+ * triangles; for convex polygons the result is a fan around the first corner.
+ */
+void triangulate(const vector<Point3f> &v, vector<FaceCorner> face, vector<FaceCorner> &out) {
+    size_t npolys = face.size();
+    if(npolys < 3) return; // Face must have 3+ vertices.
+
+    // Find the two axes to work in.
+    int axes[2] = {1, 2};
+    for(size_t k = 0; k < npolys; ++k) {
+        const Point3f &v0 = v[face[(k + 0) % npolys].v];
+        const Point3f &v1 = v[face[(k + 1) % npolys].v];
+        const Point3f &v2 = v[face[(k + 2) % npolys].v];
+        Vector3f e0 = v1 - v0;
+        Vector3f e1 = v2 - v1;
+        real_type cx = std::fabs(e0.y * e1.z - e0.z * e1.y);
+        real_type cy = std::fabs(e0.z * e1.x - e0.x * e1.z);
+        real_type cz = std::fabs(e0.x * e1.y - e0.y * e1.x);
+        const real_type epsilon = std::numeric_limits<real_type>::epsilon();
+        if(cx > epsilon || cy > epsilon || cz > epsilon) {
+            // Found a corner.
+            if(!(cx > cy && cx > cz)) {
+                axes[0] = 0;
+                if(cz > cx && cz > cy) axes[1] = 1;
+            }
+            break;
+        }
+    }
+
+    real_type area = 0;
+    for(size_t k = 0; k < npolys; ++k) {
+        const Point3f &v0 = v[face[(k + 0) % npolys].v];
+        const Point3f &v1 = v[face[(k + 1) % npolys].v];
+        area += (v0[axes[0]] * v1[axes[1]] - v0[axes[1]] * v1[axes[0]]) * real_type(0.5);
+    }
+
+    size_t guess_vert = 0;
+    FaceCorner ind[3];
+    real_type vx[3], vy[3];
+
+    // How many iterations can we do without decreasing the remaining vertices.
+    size_t remaining_iterations = face.size();
+    size_t previous_remaining = face.size();
+
+    while(face.size() > 3 && remaining_iterations > 0) {
+        npolys = face.size();
+        if(guess_vert >= npolys) guess_vert -= npolys;
+
+        if(previous_remaining != npolys) {
+            // The number of remaining vertices decreased. Reset counters.
+            previous_remaining = npolys;
+            remaining_iterations = npolys;
+        } else {
+            // We didn't consume a vertex on previous iteration.
+            remaining_iterations--;
+        }
+
+        for(size_t k = 0; k < 3; k++) {
+            ind[k] = face[(guess_vert + k) % npolys];
+            vx[k] = v[ind[k].v][axes[0]];
+            vy[k] = v[ind[k].v][axes[1]];
+        }
+        real_type cross = (vx[1] - vx[0]) * (vy[2] - vy[1]) - (vy[1] - vy[0]) * (vx[2] - vx[1]);
+        // If an internal angle.
+        if(cross * area < real_type(0)) {
+            guess_vert += 1;
+            continue;
+        }
+
+        // Check all other verts in case they are inside this triangle.
+        bool overlap = false;
+        for(size_t other = 3; other < npolys; ++other) {
+            const Point3f &t = v[face[(guess_vert + other) % npolys].v];
+            if(pnpoly(3, vx, vy, t[axes[0]], t[axes[1]])) {
+                overlap = true;
+                break;
+            }
+        }
+        if(overlap) {
+            guess_vert += 1;
+            continue;
+        }
+
+        // This triangle is an ear.
+        out.insert(out.end(), ind, ind + 3);
+
+        // Remove v1 from the list.
+        face.erase(face.begin() + (guess_vert + 1) % npolys);
+    }
+
+    if(face.size() == 3) out.insert(out.end(), face.begin(), face.end());
+}
+
+/// Runs `work(k)` for k in [0, n) on `pool`.
+template <typename F>
+void for_each_chunk(WorkStealingPool &pool, size_t n, F work) {
+    pool.run(n, [&](size_t k, int) { work(k); });
+}
+
+} // namespace
+
+bool load_obj_parallel( const std::string & filename, bool rvo, bool cn, bool fn,
+                        shared_ptr<TriangleMesh> md, unsigned n_threads ) {
+    std::cout << "Loading " << filename << std::endl;
+    auto start = std::chrono::steady_clock::now();
+
+    auto file = MappedFile::open(filename);
+    if(file == nullptr) {
+        RT3_WARNING("Could not map \"" + filename + "\".");
+        return false;
+    }
+    const char *data = file->data();
+    const char *data_end = data + file->size();
+
+    // [1] Split the file at line boundaries.
+    if(n_threads == 0) n_threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t max_chunks = std::max<size_t>(1, file->size() / MIN_CHUNK_BYTES);
+    size_t n_chunks = std::min<size_t>(n_threads, max_chunks);
+
+    vector<const char*> bounds{ data };
+    for(size_t k = 1; k < n_chunks; ++k) {
+        const char *p = data + k * file->size() / n_chunks;
+        p = std::max(p, bounds.back());
+        bounds.push_back(next_line(p, data_end));
+    }
+    bounds.push_back(data_end);
+    WorkStealingPool pool{ static_cast<int>(n_chunks) };
+
+    // [2] Parse every chunk on its own thread.
+    vector<ObjChunk> chunks(n_chunks);
+    for_each_chunk(pool, n_chunks, [&](size_t k) { parse_chunk(bounds[k], bounds[k + 1], chunks[k]); });
+
+    for(auto &c : chunks) {
+        if(!c.ok) {
+            RT3_WARNING("\"" + filename + "\": " + c.error + ".");
+            return false;
+        }
+    }
+
+    // [3] Prefix sums give each chunk its place in the vertex arrays.
+    struct Offsets { size_t v = 0, vn = 0, vt = 0, idx = 0; };
+    vector<Offsets> offsets(n_chunks + 1);
+    for(size_t k = 0; k < n_chunks; ++k) {
+        offsets[k + 1].v = offsets[k].v + chunks[k].vertices.size();
+        offsets[k + 1].vn = offsets[k].vn + chunks[k].normals.size();
+        offsets[k + 1].vt = offsets[k].vt + chunks[k].uvcoords.size();
+    }
+
+    vector<Point3f> vertices(offsets.back().v);
+    vector<Normal3f> normals(offsets.back().vn);
+    vector<Point2f> uvcoords(offsets.back().vt);
+
+    // [4] Copy the vertex data, make the face indices global and validate them.
+    real_type flip = (fn) ? -1 : 1;
+    for_each_chunk(pool, n_chunks, [&](size_t k) {
+        ObjChunk &c = chunks[k];
+        const Offsets &o = offsets[k];
+        std::copy(c.vertices.begin(), c.vertices.end(), vertices.begin() + o.v);
+        for(size_t i = 0; i < c.normals.size(); ++i) {
+            normals[o.vn + i] = glm::normalize(c.normals[i] * flip);
+        }
+        std::copy(c.uvcoords.begin(), c.uvcoords.end(), uvcoords.begin() + o.vt);
+
+        for(size_t pos : c.relative_v) c.corners[pos].v += static_cast<int>(o.v);
+        for(size_t pos : c.relative_vt) c.corners[pos].vt += static_cast<int>(o.vt);
+        for(size_t pos : c.relative_vn) c.corners[pos].vn += static_cast<int>(o.vn);
+
+        auto in_range = [](int idx, size_t n) { return idx >= 0 && idx < static_cast<int>(n); };
+        for(auto &corner : c.corners) {
+            if(!in_range(corner.v, vertices.size())
+               || (corner.has_vn && !in_range(corner.vn, normals.size()))
+               || (corner.has_vt && !in_range(corner.vt, uvcoords.size()))) {
+                c.ok = false;
+                c.error = "face index out of range";
+                return;
+            }
+        }
+    });
+
+    for(auto &c : chunks) {
+        if(!c.ok) {
+            RT3_WARNING("\"" + filename + "\": " + c.error + ".");
+            return false;
+        }
+    }
+
+    // [5] Triangulate each chunk's faces; this needs the final vertex positions.
+    for_each_chunk(pool, n_chunks, [&](size_t k) {
+        ObjChunk &c = chunks[k];
+        c.triangles.reserve(c.corners.size());
+        vector<FaceCorner> face;
+        size_t first = 0;
+        for(int size : c.face_sizes) {
+            face.assign(c.corners.begin() + first, c.corners.begin() + first + size);
+            triangulate(vertices, std::move(face), c.triangles);
+            first += size;
+        }
+    });
+
+    for(size_t k = 0; k < n_chunks; ++k) {
+        offsets[k + 1].idx = offsets[k].idx + chunks[k].triangles.size();
+    }
+    const Offsets &total = offsets.back();
+
+    // [6] Copy the triangles into the flat index arrays.
+    vector<int> vertex_indices(total.idx), normal_indices(total.idx), uvcoord_indices(total.idx);
+    for_each_chunk(pool, n_chunks, [&](size_t k) {
+        const auto &tris = chunks[k].triangles;
+        size_t out = offsets[k].idx;
+        for(size_t t = 0; t < tris.size(); t += 3) {
+            for(size_t i = 0; i < 3; ++i, ++out) {
+                // Invert order of vertices if flag is on.
+                const FaceCorner &c = tris[t + ((rvo) ? 2 - i : i)];
+                vertex_indices[out] = c.v;
+                normal_indices[out] = c.vn;
+                uvcoord_indices[out] = c.vt;
+            }
+        }
+    });
+    // Release the per-chunk memory before the mesh buffers are built.
+    chunks.clear();
+
+    md->n_triangles = static_cast<int>(total.idx / 3);
+    md->vertices = MeshBuffer<Point3f>{ std::move(vertices) };
+    md->normals = MeshBuffer<Normal3f>{ std::move(normals) };
+    md->uvcoords = MeshBuffer<Point2f>{ std::move(uvcoords) };
+    md->vertex_indices = MeshBuffer<int>{ std::move(vertex_indices) };
+    md->normal_indices = MeshBuffer<int>{ std::move(normal_indices) };
+    md->uvcoord_indices = MeshBuffer<int>{ std::move(uvcoord_indices) };
+
+    // Do we need to compute the normals? Yes if the user requested it, or if some face has no normals.
+    bool missing_normals = std::find(md->normal_indices.begin(), md->normal_indices.end(), -1) != md->normal_indices.end();
+    if(cn || missing_normals) compute_normals(*md, fn);
+
+    auto diff = std::chrono::steady_clock::now() - start;
+    std::cout << "-- SUMMARY of the OBJ file --\n";
+    std::cout << "# of vertices  : " << total.v << std::endl;
+    std::cout << "# of normals   : " << total.vn << std::endl;
+    std::cout << "# of texcoords : " << total.vt << std::endl;
+    std::cout << "# of triangles : " << md->n_triangles << std::endl;
+    std::cout << "# of chunks    : " << n_chunks << std::endl;
+    std::cout << "load time      : " << std::chrono::duration<double, std::milli>(diff).count() << " ms\n";
+    std::cout << "-----------------------------\n";
+
+    return true;
+}
+
+}
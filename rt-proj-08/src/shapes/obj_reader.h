@@ -0,0 +1,30 @@
+#ifndef OBJ_READER_H
+#define OBJ_READER_H
+
+#include "triangle_mesh.h"
+
+namespace rt3{
+
+/*!
+ * Multi-threaded OBJ reader.
+ *
+ * The file is memory mapped and split at line boundaries into one chunk per thread.
+ * Every thread parses its chunk (`v`, `vn`, `vt` and `f` lines) with `std::from_chars`
+ * into local arrays; the chunks are then copied, also in parallel, into the mesh's flat
+ * arrays at offsets given by a prefix sum of the per-chunk counts.
+ *
+ * Polygons are split by ear clipping, the same way tinyobjloader does it, so the resulting
+ * triangles are identical to the ones `load_mesh_data_tinyobj` produces.
+ * Groups, materials and the other statements are ignored, as in `extract_obj_data`.
+ *
+ * \param rvo Reverse the vertex order of every triangle.
+ * \param cn Compute the normals, even if the file provides them.
+ * \param fn Flip the normals.
+ * \param n_threads # of worker threads; 0 means one per hardware thread.
+ */
+bool load_obj_parallel( const std::string & filename, bool rvo, bool cn, bool fn,
+                        shared_ptr<TriangleMesh> md, unsigned n_threads = 0 );
+
+}
+
+#endif
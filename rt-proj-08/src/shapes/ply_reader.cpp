@@ -0,0 +1,420 @@
+#include "ply_reader.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <sstream>
+
+#include "../core/mapped_file.h"
+
+namespace rt3 {
+
+namespace {
+
+enum class ply_format_e { ASCII, BINARY_LE, BINARY_BE };
+
+enum class ply_type_e { INT8, UINT8, INT16, UINT16, INT32, UINT32, FLOAT32, FLOAT64, INVALID };
+
+struct PlyProperty {
+    string name;
+    ply_type_e type = ply_type_e::INVALID;       //!< Type of the value (of the items, for lists).
+    ply_type_e count_type = ply_type_e::INVALID; //!< Type of the item count; INVALID if not a list.
+
+    bool is_list() const { return count_type != ply_type_e::INVALID; }
+};
+
+struct PlyElement {
+    string name;
+    size_t count = 0;
+    vector<PlyProperty> properties;
+};
+
+ply_type_e parse_type(const string &name) {
+    if(name == "char" || name == "int8") return ply_type_e::INT8;
+    if(name == "uchar" || name == "uint8") return ply_type_e::UINT8;
+    if(name == "short" || name == "int16") return ply_type_e::INT16;
+    if(name == "ushort" || name == "uint16") return ply_type_e::UINT16;
+    if(name == "int" || name == "int32") return ply_type_e::INT32;
+    if(name == "uint" || name == "uint32") return ply_type_e::UINT32;
+    if(name == "float" || name == "float32") return ply_type_e::FLOAT32;
+    if(name == "double" || name == "float64") return ply_type_e::FLOAT64;
+    return ply_type_e::INVALID;
+}
+
+bool host_is_little_endian() {
+    const uint16_t one = 1;
+    unsigned char first;
+    std::memcpy(&first, &one, 1);
+    return first == 1;
+}
+
+/// Sequential reader over the body of the file; every value comes out as a double.
+class PlyStream {
+public:
+    PlyStream(const char *begin, const char *end, ply_format_e format)
+    : p(begin), end(end), format(format),
+      swap(format != ply_format_e::ASCII && (format == ply_format_e::BINARY_LE) != host_is_little_endian())
+    {/*empty*/}
+
+    double read(ply_type_e type) {
+        if(format == ply_format_e::ASCII) return read_ascii();
+        switch(type) {
+            case ply_type_e::INT8:    return load<int8_t>();
+            case ply_type_e::UINT8:   return load<uint8_t>();
+            case ply_type_e::INT16:   return load<int16_t>();
+            case ply_type_e::UINT16:  return load<uint16_t>();
+            case ply_type_e::INT32:   return load<int32_t>();
+            case ply_type_e::UINT32:  return load<uint32_t>();
+            case ply_type_e::FLOAT32: return load<float>();
+            case ply_type_e::FLOAT64: return load<double>();
+            default: ok = false; return 0;
+        }
+    }
+
+    /// Reads and throws away one property of an element.
+    void skip(const PlyProperty &prop) {
+        if(!prop.is_list()) {
+            read(prop.type);
+            return;
+        }
+        size_t n = read_count(prop.count_type);
+        for(size_t i = 0; i < n && ok; ++i) read(prop.type);
+    }
+
+    /// Reads the item count of a list. Every item takes at least a byte, so a count that is
+    /// negative, not whole or larger than what is left of the file means a corrupt file.
+    size_t read_count(ply_type_e type) {
+        double n = read(type);
+        if(!(n >= 0 && n <= static_cast<double>(end - p) && n == std::floor(n))) {
+            ok = false;
+            return 0;
+        }
+        return static_cast<size_t>(n);
+    }
+
+    /// # of bytes not read yet.
+    size_t left() const { return end - p; }
+
+    bool good() const { return ok; }
+
+private:
+    template <typename T>
+    double load() {
+        if(static_cast<size_t>(end - p) < sizeof(T)) {
+            ok = false;
+            return 0;
+        }
+        char bytes[sizeof(T)];
+        std::memcpy(bytes, p, sizeof(T));
+        if(swap) std::reverse(bytes, bytes + sizeof(T));
+        p += sizeof(T);
+        if constexpr(std::is_floating_point_v<T>) {
+            // NaNs and infinities are caught on the bits: -ffast-math lets the compiler assume
+            // there are none, and read_count() and the index check in load_ply() would let them through.
+            using Bits = std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>;
+            constexpr int mantissa = std::numeric_limits<T>::digits - 1;
+            constexpr Bits exponent = ((Bits(1) << (8 * sizeof(T) - 1 - mantissa)) - 1) << mantissa;
+            Bits bits;
+            std::memcpy(&bits, bytes, sizeof(T));
+            if((bits & exponent) == exponent) {
+                ok = false;
+                return 0;
+            }
+        }
+        T value;
+        std::memcpy(&value, bytes, sizeof(T));
+        return static_cast<double>(value);
+    }
+
+    double read_ascii() {
+        while(p < end && std::isspace(static_cast<unsigned char>(*p))) ++p;
+        if(p < end && *p == '+') ++p;
+        double value = 0;
+        auto [ptr, ec] = std::from_chars(p, end, value);
+        // from_chars takes "nan" and "inf" too; every spelling of them has an n.
+        if(ec != std::errc() || std::find_if(p, ptr, [](char c) { return c == 'n' || c == 'N'; }) != ptr) {
+            ok = false;
+            return 0;
+        }
+        p = ptr;
+        return value;
+    }
+
+    const char *p;
+    const char *end;
+    ply_format_e format;
+    bool swap; //!< File and host byte orders differ.
+    bool ok = true;
+};
+
+/// Parses the header; `body` is set to the first byte after `end_header`.
+bool parse_header(const char *data, size_t size, ply_format_e &format,
+                  vector<PlyElement> &elements, const char *&body, string &error) {
+    // Only at the start of a line: a comment may mention it too.
+    const char tag[] = "end_header";
+    const size_t tag_size = sizeof(tag) - 1;
+    const char *header_end = data;
+    for(;; header_end += tag_size) {
+        header_end = std::search(header_end, data + size, tag, tag + tag_size);
+        if(header_end == data + size) break;
+        const char *after = header_end + tag_size;
+        bool line_start = header_end == data || header_end[-1] == '\n';
+        bool line_end = after == data + size || std::isspace(static_cast<unsigned char>(*after));
+        if(line_start && line_end) break;
+    }
+    if(header_end == data + size) {
+        error = "missing end_header";
+        return false;
+    }
+    const void *nl = std::memchr(header_end, '\n', data + size - header_end);
+    body = nl ? static_cast<const char*>(nl) + 1 : data + size;
+
+    std::istringstream header{string(data, header_end)};
+    string line;
+    std::getline(header, line);
+    if(line.compare(0, 3, "ply") != 0) {
+        error = "not a PLY file";
+        return false;
+    }
+
+    bool has_format = false;
+    while(std::getline(header, line)) {
+        std::istringstream tokens{line};
+        string keyword;
+        tokens >> keyword;
+        if(keyword == "format") {
+            string name;
+            tokens >> name;
+            if(name == "ascii") format = ply_format_e::ASCII;
+            else if(name == "binary_little_endian") format = ply_format_e::BINARY_LE;
+            else if(name == "binary_big_endian") format = ply_format_e::BINARY_BE;
+            else {
+                error = "unknown format \"" + name + "\"";
+                return false;
+            }
+            has_format = true;
+        } else if(keyword == "element") {
+            PlyElement element;
+            tokens >> element.name >> element.count;
+            elements.push_back(element);
+        } else if(keyword == "property") {
+            if(elements.empty()) {
+                error = "property declared before any element";
+                return false;
+            }
+            PlyProperty prop;
+            string type;
+            tokens >> type;
+            if(type == "list") {
+                string count_type, item_type;
+                tokens >> count_type >> item_type;
+                prop.count_type = parse_type(count_type);
+                prop.type = parse_type(item_type);
+                if(prop.count_type == ply_type_e::INVALID) {
+                    error = "unknown type \"" + count_type + "\"";
+                    return false;
+                }
+            } else {
+                prop.type = parse_type(type);
+            }
+            if(prop.type == ply_type_e::INVALID) {
+                error = "unknown type in \"" + line + "\"";
+                return false;
+            }
+            tokens >> prop.name;
+            elements.back().properties.push_back(prop);
+        }
+        // `comment`, `obj_info` and blank lines are ignored.
+    }
+
+    if(!has_format) {
+        error = "missing format line";
+        return false;
+    }
+    return true;
+}
+
+/// Where each vertex property goes.
+enum vertex_slot_e { X, Y, Z, NX, NY, NZ, U, V, N_SLOTS, IGNORED = N_SLOTS };
+
+vertex_slot_e vertex_slot(const string &name) {
+    if(name == "x") return X;
+    if(name == "y") return Y;
+    if(name == "z") return Z;
+    if(name == "nx") return NX;
+    if(name == "ny") return NY;
+    if(name == "nz") return NZ;
+    if(name == "u" || name == "s" || name == "texture_u" || name == "texture_s") return U;
+    if(name == "v" || name == "t" || name == "texture_v" || name == "texture_t") return V;
+    return IGNORED;
+}
+
+} // namespace
+
+bool is_ply_file( const std::string &filename ) {
+    const std::string ext{".ply"};
+    return filename.size() >= ext.size()
+        && filename.compare(filename.size() - ext.size(), ext.size(), ext) == 0;
+}
+
+bool load_ply( const std::string & filename, bool rvo, bool cn, bool fn,
+               shared_ptr<TriangleMesh> md ) {
+    std::cout << "Loading " << filename << std::endl;
+    auto start = std::chrono::steady_clock::now();
+
+    auto file = MappedFile::open(filename);
+    if(file == nullptr) {
+        RT3_WARNING("Could not map \"" + filename + "\".");
+        return false;
+    }
+
+    ply_format_e format = ply_format_e::ASCII;
+    vector<PlyElement> elements;
+    const char *body = nullptr;
+    string error;
+    if(!parse_header(file->data(), file->size(), format, elements, body, error)) {
+        RT3_WARNING("\"" + filename + "\": " + error + ".");
+        return false;
+    }
+
+    vector<Point3f> vertices;
+    vector<Normal3f> normals;
+    vector<Point2f> uvcoords;
+    vector<int> indices;
+    bool has_faces = false;
+
+    // Faces may come before the vertices, so their indices are checked against the header's count.
+    double vertex_count = 0;
+    for(const auto &element : elements) {
+        if(element.name == "vertex") vertex_count = std::min<double>(element.count, std::numeric_limits<int>::max());
+    }
+
+    PlyStream in{body, file->data() + file->size(), format};
+    for(const auto &element : elements) {
+        // Every element takes at least a byte; this keeps a corrupt count from sizing the arrays.
+        if(element.count > in.left()) {
+            RT3_WARNING("\"" + filename + "\": more \"" + element.name + "\" elements than the file can hold.");
+            return false;
+        }
+        if(element.name == "vertex") {
+            vector<vertex_slot_e> slots;
+            bool present[N_SLOTS + 1] = {};
+            for(const auto &prop : element.properties) {
+                slots.push_back(prop.is_list() ? IGNORED : vertex_slot(prop.name));
+                present[slots.back()] = true;
+            }
+            if(!present[X] || !present[Y] || !present[Z]) {
+                RT3_WARNING("\"" + filename + "\": vertices have no x, y, z.");
+                return false;
+            }
+            bool has_normals = present[NX] && present[NY] && present[NZ];
+            bool has_uvs = present[U] && present[V];
+
+            vertices.reserve(element.count);
+            if(has_normals) normals.reserve(element.count);
+            if(has_uvs) uvcoords.reserve(element.count);
+
+            double values[N_SLOTS + 1] = {};
+            for(size_t i = 0; i < element.count && in.good(); ++i) {
+                for(size_t k = 0; k < slots.size(); ++k) {
+                    if(slots[k] == IGNORED) in.skip(element.properties[k]);
+                    else values[slots[k]] = in.read(element.properties[k].type);
+                }
+                vertices.push_back(Point3f{values[X], values[Y], values[Z]});
+                if(has_normals) normals.push_back(Normal3f{values[NX], values[NY], values[NZ]});
+                if(has_uvs) uvcoords.push_back(Point2f{values[U], values[V]});
+            }
+        } else if(element.name == "face") {
+            has_faces = true;
+            int list = -1;
+            for(size_t k = 0; k < element.properties.size(); ++k) {
+                const auto &prop = element.properties[k];
+                if(prop.is_list() && (prop.name == "vertex_indices" || prop.name == "vertex_index")) list = k;
+            }
+            if(list < 0) {
+                RT3_WARNING("\"" + filename + "\": faces have no vertex_indices list.");
+                return false;
+            }
+
+            // Most scans are pure triangle meshes; quads and larger polygons grow the array.
+            indices.reserve(3 * element.count);
+            vector<int> face;
+            for(size_t i = 0; i < element.count && in.good(); ++i) {
+                for(size_t k = 0; k < element.properties.size(); ++k) {
+                    const auto &prop = element.properties[k];
+                    if(static_cast<int>(k) != list) {
+                        in.skip(prop);
+                        continue;
+                    }
+                    size_t n = in.read_count(prop.count_type);
+                    face.clear();
+                    for(size_t c = 0; c < n && in.good(); ++c) {
+                        // Checked before narrowing: a uint or double index may not fit an int.
+                        double idx = in.read(prop.type);
+                        if(!(idx >= 0 && idx < vertex_count)) {
+                            RT3_WARNING("\"" + filename + "\" has out of range indices.");
+                            return false;
+                        }
+                        face.push_back(static_cast<int>(idx));
+                    }
+                    for(size_t c = 1; c + 1 < face.size(); ++c) {
+                        indices.push_back(face[0]);
+                        indices.push_back(face[c]);
+                        indices.push_back(face[c + 1]);
+                    }
+                }
+            }
+        } else {
+            for(size_t i = 0; i < element.count && in.good(); ++i) {
+                for(const auto &prop : element.properties) in.skip(prop);
+            }
+        }
+
+        if(!in.good()) {
+            RT3_WARNING("\"" + filename + "\": unexpected data in element \"" + element.name + "\".");
+            return false;
+        }
+    }
+
+    if(!has_faces) {
+        RT3_WARNING("\"" + filename + "\" has no faces.");
+        return false;
+    }
+    // Invert order of vertices if flag is on.
+    if(rvo) {
+        for(size_t t = 0; t < indices.size(); t += 3) std::swap(indices[t], indices[t + 2]);
+    }
+
+    real_type flip = (fn) ? -1 : 1;
+    for(auto &n : normals) n = glm::normalize(n * flip);
+
+    size_t n_vertices = vertices.size(), n_normals = normals.size(), n_uvcoords = uvcoords.size();
+    MeshBuffer<int> index_buffer{std::move(indices)};
+    md->n_triangles = static_cast<int>(index_buffer.size() / 3);
+    md->vertices = MeshBuffer<Point3f>{ std::move(vertices) };
+    md->vertex_indices = index_buffer;
+    md->normals = MeshBuffer<Normal3f>{ std::move(normals) };
+    md->normal_indices = index_buffer;
+    md->uvcoords = MeshBuffer<Point2f>{ std::move(uvcoords) };
+    md->uvcoord_indices = (n_uvcoords > 0) ? index_buffer : MeshBuffer<int>{};
+
+    if(cn || n_normals == 0) compute_normals(*md, fn);
+
+    auto diff = std::chrono::steady_clock::now() - start;
+    std::cout << "-- SUMMARY of the PLY file --\n";
+    std::cout << "# of vertices  : " << n_vertices << std::endl;
+    std::cout << "# of normals   : " << n_normals << std::endl;
+    std::cout << "# of texcoords : " << n_uvcoords << std::endl;
+    std::cout << "# of triangles : " << md->n_triangles << std::endl;
+    std::cout << "load time      : " << std::chrono::duration<double, std::milli>(diff).count() << " ms\n";
+    std::cout << "-----------------------------\n";
+
+    return true;
+}
+
+}
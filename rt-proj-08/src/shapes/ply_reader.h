@@ -0,0 +1,31 @@
+#ifndef PLY_READER_H
+#define PLY_READER_H
+
+#include "triangle_mesh.h"
+
+namespace rt3{
+
+/*!
+ * Streaming PLY reader.
+ *
+ * Reads `ascii`, `binary_little_endian` and `binary_big_endian` files, straight from a
+ * memory mapping into the mesh's flat arrays. The `vertex` element must have `x`, `y`
+ * and `z`; `nx`/`ny`/`nz` and `u`/`v` (or `s`/`t`, `texture_u`/`texture_v`) are used
+ * when present. The `face` element must have a `vertex_indices` (or `vertex_index`)
+ * list; polygons are triangulated as fans. Other properties and elements are skipped.
+ *
+ * Normals and UV coordinates are per vertex, so they share the vertex indices.
+ *
+ * \param rvo Reverse the vertex order of every triangle.
+ * \param cn Compute the normals, even if the file provides them.
+ * \param fn Flip the normals.
+ */
+bool load_ply( const std::string & filename, bool rvo, bool cn, bool fn,
+               shared_ptr<TriangleMesh> md );
+
+/// Tells whether `filename` has the `.ply` extension.
+bool is_ply_file( const std::string &filename );
+
+}
+
+#endif
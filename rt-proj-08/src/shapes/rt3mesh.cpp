@@ -0,0 +1,218 @@
+#include "rt3mesh.h"
+
+#include <cstring>
+#include <fstream>
+
+#include "../core/mapped_file.h"
+
+namespace rt3 {
+
+// The mesh buffers point straight into the file, so the in-memory layout must match it.
+static_assert(sizeof(Point3f) == 3 * sizeof(float), "Point3f must be tightly packed");
+static_assert(sizeof(Point2f) == 2 * sizeof(float), "Point2f must be tightly packed");
+static_assert(sizeof(int) == sizeof(int32_t), "indices are stored as 32-bit integers");
+
+namespace {
+
+template <typename T>
+uint64_t section_bytes(const RT3MeshSection &s) { return s.count * sizeof(T); }
+
+/// Checks that a section lies inside the file and is properly aligned.
+template <typename T>
+bool valid_section(const RT3MeshSection &s, size_t file_size) {
+    if(s.count == 0) return true;
+    if(s.offset % alignof(T) != 0) return false;
+    if(s.offset > file_size) return false;
+    return section_bytes<T>(s) <= file_size - s.offset;
+}
+
+template <typename T>
+MeshBuffer<T> view_section(const RT3MeshSection &s, const shared_ptr<MappedFile> &file) {
+    return MeshBuffer<T>(reinterpret_cast<const T*>(file->data() + s.offset), s.count, file);
+}
+
+/// Every index must address an existing element (or be -1, when `allow_missing`).
+bool valid_indices(const MeshBuffer<int> &indices, size_t n_elements, bool allow_missing) {
+    for(int idx : indices) {
+        if(idx == -1 && allow_missing) continue;
+        if(idx < 0 || static_cast<size_t>(idx) >= n_elements) return false;
+    }
+    return true;
+}
+
+uint64_t align_up(uint64_t offset) {
+    return (offset + RT3MESH_ALIGNMENT - 1) / RT3MESH_ALIGNMENT * RT3MESH_ALIGNMENT;
+}
+
+} // namespace
+
+bool is_rt3mesh_file( const std::string &filename ) {
+    const std::string ext{".rt3mesh"};
+    return filename.size() >= ext.size()
+        && filename.compare(filename.size() - ext.size(), ext.size(), ext) == 0;
+}
+
+bool load_rt3mesh( const std::string &filename, shared_ptr<TriangleMesh> md, Bounds3f *bounds ) {
+    std::cout << "Mapping " << filename << std::endl;
+
+    auto file = MappedFile::open(filename);
+    if(file == nullptr) {
+        RT3_WARNING("Could not map \"" + filename + "\".");
+        return false;
+    }
+
+    if(file->size() < sizeof(RT3MeshHeader)) {
+        RT3_WARNING("\"" + filename + "\" is too small to be a .rt3mesh file.");
+        return false;
+    }
+
+    RT3MeshHeader header;
+    std::memcpy(&header, file->data(), sizeof(header));
+
+    if(std::memcmp(header.magic, RT3MESH_MAGIC, sizeof(header.magic)) != 0) {
+        RT3_WARNING("\"" + filename + "\" is not a .rt3mesh file.");
+        return false;
+    }
+    if(header.byte_order != RT3MESH_BYTE_ORDER) {
+        RT3_WARNING("\"" + filename + "\" was written with a different byte order; re-run the converter.");
+        return false;
+    }
+    if(header.version != RT3MESH_VERSION) {
+        RT3_WARNING("\"" + filename + "\" has an unsupported version (" + std::to_string(header.version) + ").");
+        return false;
+    }
+
+    auto section = [&](rt3mesh_section_e s) -> const RT3MeshSection& {
+        return header.sections[static_cast<int>(s)];
+    };
+
+    const auto &pos = section(rt3mesh_section_e::POSITIONS);
+    const auto &nrm = section(rt3mesh_section_e::NORMALS);
+    const auto &uvs = section(rt3mesh_section_e::UVCOORDS);
+    const auto &v_idx = section(rt3mesh_section_e::VERTEX_INDICES);
+    const auto &n_idx = section(rt3mesh_section_e::NORMAL_INDICES);
+    const auto &uv_idx = section(rt3mesh_section_e::UVCOORD_INDICES);
+
+    const uint64_t n_indices = 3 * uint64_t(header.n_triangles);
+    bool ok = valid_section<Point3f>(pos, file->size())
+           && valid_section<Normal3f>(nrm, file->size())
+           && valid_section<Point2f>(uvs, file->size())
+           && valid_section<int32_t>(v_idx, file->size())
+           && valid_section<int32_t>(n_idx, file->size())
+           && valid_section<int32_t>(uv_idx, file->size())
+           && v_idx.count == n_indices
+           && n_idx.count == n_indices
+           && (uv_idx.count == 0 || uv_idx.count == n_indices);
+    if(!ok) {
+        RT3_WARNING("\"" + filename + "\" has a corrupted section table.");
+        return false;
+    }
+
+    md->n_triangles = header.n_triangles;
+    md->backface_cull = (header.flags & 1u) != 0;
+    md->vertices = view_section<Point3f>(pos, file);
+    md->normals = view_section<Normal3f>(nrm, file);
+    md->uvcoords = view_section<Point2f>(uvs, file);
+    md->vertex_indices = view_section<int>(v_idx, file);
+    md->normal_indices = view_section<int>(n_idx, file);
+    md->uvcoord_indices = view_section<int>(uv_idx, file);
+
+    if(!valid_indices(md->vertex_indices, md->vertices.size(), false)
+       || !valid_indices(md->normal_indices, md->normals.size(), false)
+       || !valid_indices(md->uvcoord_indices, md->uvcoords.size(), true)) {
+        RT3_WARNING("\"" + filename + "\" has out of range indices.");
+        return false;
+    }
+
+    if(bounds != nullptr) {
+        *bounds = Bounds3f(
+            Point3f{header.bounds_min[0], header.bounds_min[1], header.bounds_min[2]},
+            Point3f{header.bounds_max[0], header.bounds_max[1], header.bounds_max[2]});
+    }
+
+    std::cout << "-- SUMMARY of the RT3MESH file --\n";
+    std::cout << "# of vertices  : " << md->vertices.size() << std::endl;
+    std::cout << "# of normals   : " << md->normals.size() << std::endl;
+    std::cout << "# of texcoords : " << md->uvcoords.size() << std::endl;
+    std::cout << "# of triangles : " << md->n_triangles << std::endl;
+    std::cout << "---------------------------------\n";
+
+    return true;
+}
+
+bool read_rt3mesh_bounds( const std::string &filename, Bounds3f &bounds ) {
+    std::ifstream ifs{filename, std::ios::binary};
+    RT3MeshHeader header;
+    if(!ifs.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+
+    if(std::memcmp(header.magic, RT3MESH_MAGIC, sizeof(header.magic)) != 0
+       || header.byte_order != RT3MESH_BYTE_ORDER || header.version != RT3MESH_VERSION) {
+        return false;
+    }
+
+    bounds = Bounds3f(
+        Point3f{header.bounds_min[0], header.bounds_min[1], header.bounds_min[2]},
+        Point3f{header.bounds_max[0], header.bounds_max[1], header.bounds_max[2]});
+    return true;
+}
+
+bool save_rt3mesh( const std::string &filename, const TriangleMesh &mesh ) {
+    if(mesh.normals.empty() || mesh.normal_indices.size() != mesh.vertex_indices.size()) {
+        RT3_WARNING("Cannot save a mesh without normals; compute them first.");
+        return false;
+    }
+
+    RT3MeshHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, RT3MESH_MAGIC, sizeof(header.magic));
+    header.version = RT3MESH_VERSION;
+    header.byte_order = RT3MESH_BYTE_ORDER;
+    header.n_triangles = static_cast<uint32_t>(mesh.n_triangles);
+    header.flags = mesh.backface_cull ? 1u : 0u;
+
+    Bounds3f box = mesh.compute_bounds();
+    for(int i = 0; i < 3; ++i) {
+        header.bounds_min[i] = box.min_point[i];
+        header.bounds_max[i] = box.max_point[i];
+    }
+
+    // The UV indices are dropped if they don't point to anything.
+    bool has_uvs = !mesh.uvcoords.empty() && mesh.uvcoord_indices.size() == mesh.vertex_indices.size();
+
+    struct Payload { const void *data; uint64_t count; uint64_t elem_size; };
+    const Payload payloads[] = {
+        { mesh.vertices.data(), mesh.vertices.size(), sizeof(Point3f) },
+        { mesh.normals.data(), mesh.normals.size(), sizeof(Normal3f) },
+        { mesh.uvcoords.data(), has_uvs ? mesh.uvcoords.size() : 0, sizeof(Point2f) },
+        { mesh.vertex_indices.data(), mesh.vertex_indices.size(), sizeof(int32_t) },
+        { mesh.normal_indices.data(), mesh.normal_indices.size(), sizeof(int32_t) },
+        { mesh.uvcoord_indices.data(), has_uvs ? mesh.uvcoord_indices.size() : 0, sizeof(int32_t) },
+    };
+
+    uint64_t offset = sizeof(RT3MeshHeader);
+    for(int s = 0; s < static_cast<int>(rt3mesh_section_e::COUNT); ++s) {
+        offset = align_up(offset);
+        header.sections[s] = { offset, payloads[s].count };
+        offset += payloads[s].count * payloads[s].elem_size;
+    }
+
+    std::ofstream ofs{filename, std::ios::binary};
+    if(!ofs.is_open()) {
+        RT3_WARNING("Could not open \"" + filename + "\" for writing.");
+        return false;
+    }
+
+    const char zeros[RT3MESH_ALIGNMENT] = {};
+    ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    uint64_t written = sizeof(header);
+    for(int s = 0; s < static_cast<int>(rt3mesh_section_e::COUNT); ++s) {
+        ofs.write(zeros, header.sections[s].offset - written);
+        uint64_t bytes = payloads[s].count * payloads[s].elem_size;
+        ofs.write(static_cast<const char*>(payloads[s].data), bytes);
+        written = header.sections[s].offset + bytes;
+    }
+
+    return ofs.good();
+}
+
+}
@@ -0,0 +1,71 @@
+#ifndef RT3MESH_H
+#define RT3MESH_H
+
+#include <cstdint>
+
+#include "triangle_mesh.h"
+
+namespace rt3{
+
+/*
+ * Layout of a `.rt3mesh` file (version 1), host byte order:
+ *
+ *   RT3MeshHeader
+ *   [padding] positions       n_positions x Point3f
+ *   [padding] normals         n_normals   x Normal3f
+ *   [padding] uv coords       n_uvcoords  x Point2f
+ *   [padding] vertex indices  3 * n_triangles x int32
+ *   [padding] normal indices  3 * n_triangles x int32
+ *   [padding] uv indices      3 * n_triangles x int32 (or empty)
+ *
+ * Every section starts at a multiple of RT3MESH_ALIGNMENT bytes, so the loader can
+ * point the mesh buffers straight into the mapped file.
+ */
+
+constexpr char RT3MESH_MAGIC[8] = {'R', 'T', '3', 'M', 'E', 'S', 'H', '\0'};
+constexpr uint32_t RT3MESH_VERSION = 1;
+constexpr uint32_t RT3MESH_BYTE_ORDER = 0x01020304;
+constexpr uint64_t RT3MESH_ALIGNMENT = 64;
+
+/// Sections of a `.rt3mesh` file, in the order they are stored.
+enum class rt3mesh_section_e : int {
+    POSITIONS = 0,
+    NORMALS,
+    UVCOORDS,
+    VERTEX_INDICES,
+    NORMAL_INDICES,
+    UVCOORD_INDICES,
+    COUNT
+};
+
+struct RT3MeshSection {
+    uint64_t offset; //!< Byte offset from the beginning of the file.
+    uint64_t count;  //!< # of elements (not bytes) in the section.
+};
+
+struct RT3MeshHeader {
+    char magic[8];        //!< Always RT3MESH_MAGIC.
+    uint32_t version;     //!< Format version, RT3MESH_VERSION.
+    uint32_t byte_order;  //!< RT3MESH_BYTE_ORDER, as written by the converter's machine.
+    uint32_t n_triangles; //!< # of triangles in the mesh.
+    uint32_t flags;       //!< Bit 0: backface culling.
+    float bounds_min[3];  //!< Bounding box of the positions.
+    float bounds_max[3];
+    RT3MeshSection sections[static_cast<int>(rt3mesh_section_e::COUNT)];
+};
+
+/// Maps `filename` and makes `md` point into it; nothing is copied.
+bool load_rt3mesh( const std::string &filename, shared_ptr<TriangleMesh> md, Bounds3f *bounds = nullptr );
+
+/// Reads only the bounding box stored in the header of a `.rt3mesh` file.
+bool read_rt3mesh_bounds( const std::string &filename, Bounds3f &bounds );
+
+/// Writes `mesh` to `filename` in the `.rt3mesh` format.
+bool save_rt3mesh( const std::string &filename, const TriangleMesh &mesh );
+
+/// Returns true if `filename` has the `.rt3mesh` extension.
+bool is_rt3mesh_file( const std::string &filename );
+
+}
+
+#endif
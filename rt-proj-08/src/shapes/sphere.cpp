@@ -25,12 +25,12 @@ namespace rt3 {
             contact = transform->apply_p(contact);
             t = glm::length(contact - r.o);
 
-        isect = unique_ptr<Surfel>(new Surfel(
+        store_hit(isect,
             contact, // contact point
             transform->apply_n(normal),
             -r.d, // original ray dir
             t // t
-        ));
+        );
         return true;
     }
 
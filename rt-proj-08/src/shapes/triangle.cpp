@@ -1,4 +1,5 @@
 #include "triangle.h"
+#include "obj_reader.h"
 
 namespace rt3 {
 
@@ -110,7 +111,7 @@ bool Triangle::intersect(const Ray &r, shared_ptr<Surfel> &isect) const{
 
     if (t > epsilon && t < r.t_max) // ray intersection
     {
-        isect = unique_ptr<Surfel>(new Surfel(r(t), rt3::Lerp(v,rt3::Lerp(u, n0, n1),n2), glm::normalize(-r.d), t));
+        store_hit(isect, r(t), rt3::Lerp(v,rt3::Lerp(u, n0, n1),n2), glm::normalize(-r.d), t);
         return true;
     }
     // This means that there is a line intersection but not a ray intersection.
@@ -131,6 +132,10 @@ vector<Shape*> create_triangles(shared_ptr<TriangleMesh> mesh){
 
 
 bool load_mesh_data( const std::string & filename, bool rvo, bool cn, bool fn, shared_ptr<TriangleMesh> md ) {
+    return load_obj_parallel(filename, rvo, cn, fn, md);
+}
+
+bool load_mesh_data_tinyobj( const std::string & filename, bool rvo, bool cn, bool fn, shared_ptr<TriangleMesh> md ) {
     // Default load parameters
     const char* basepath = NULL;
     bool triangulate = true;
@@ -187,99 +192,70 @@ void extract_obj_data( const tinyobj::attrib_t& attrib,
 
   // Retrieve the complete list of vertices.
   auto n_vertices{ attrib.vertices.size()/3 };
+  vector<Point3f> vertices;
+  vertices.reserve(n_vertices);
   for ( auto idx_v{0u} ; idx_v < n_vertices; idx_v++) {
-    auto vertex = make_shared<Point3f>(Point3f{
+    vertices.push_back(Point3f{
         attrib.vertices[ 3 * idx_v + 0 ],
         attrib.vertices[ 3 * idx_v + 1 ],
-        attrib.vertices[ 3 * idx_v + 2 ] 
+        attrib.vertices[ 3 * idx_v + 2 ]
     });
-
-    md->vertices->push_back(vertex);
   }
 
   // Read the normals
-  //retrieve_normals(attrib, cn, fn, md);
   auto n_normals{ attrib.normals.size()/3 };
 
-  // TODO: flip normals if requested.
   real_type flip = (fn) ? -1 : 1;
 
-  // Do we need to compute the normals? Yes only if the user requeste or there are no normals in the file.
-  if (cn || n_normals == 0){
-      RT3_ERROR("Not implemented.");
-  }else {
-    // Read normals from file. This corresponds to the entire 'for' below.
-    // Traverse the normals read from the OBJ file.
-    for ( auto idx_n{0u} ; idx_n < n_normals; idx_n++){
-        // Store the normal.
-        auto normal = make_shared<Normal3f>(glm::normalize(Normal3f{ 
-            attrib.normals[ 3 * idx_n + 0 ] * flip,
-            attrib.normals[ 3 * idx_n + 1 ] * flip,
-            attrib.normals[ 3 * idx_n + 2 ] * flip 
-        }));
-
-        md->normals->push_back(normal);
-    }
+  vector<Normal3f> normals;
+  normals.reserve(n_normals);
+  // Read normals from file. This corresponds to the entire 'for' below.
+  // Traverse the normals read from the OBJ file.
+  for ( auto idx_n{0u} ; idx_n < n_normals; idx_n++){
+      // Store the normal.
+      normals.push_back(glm::normalize(Normal3f{
+          attrib.normals[ 3 * idx_n + 0 ] * flip,
+          attrib.normals[ 3 * idx_n + 1 ] * flip,
+          attrib.normals[ 3 * idx_n + 2 ] * flip
+      }));
   }
+
   // Read the complete list of texture coordinates.
-  // retrieve_textures(attrib, md);
+  auto n_uvs{ attrib.texcoords.size()/2 };
+  vector<Point2f> uvcoords;
+  uvcoords.reserve(n_uvs);
+  for ( auto idx_t{0u} ; idx_t < n_uvs; idx_t++){
+      uvcoords.push_back(Point2f{ attrib.texcoords[ 2 * idx_t + 0 ], attrib.texcoords[ 2 * idx_t + 1 ] });
+  }
 
   // Read mesh connectivity and store it as lists of indices to the real data.
-  //retrieve_shapes(shapes, rvo, md);
+  vector<int> vertex_indices, normal_indices, uvcoord_indices;
   auto n_shapes{ shapes.size() };
-  // stringstream ss;
   md->n_triangles = 0; // We must reset this here.
   // In case the OBJ file has the triangles organized in several shapes or groups, we
   // ignore this and store all triangles as a single mesh dataset.
   // This is why we need to reset the triangle count here.
   for ( auto idx_s{0u} ; idx_s < n_shapes; idx_s++)
   {
-      // ss << "The shape[" << idx_s << "].name = " << shapes[idx_s].name << '\n';
-      // ss << "Size of shape["<< idx_s << "].mesh.indices: "
-      //       << static_cast<unsigned long>(shapes[idx_s].mesh.indices.size()) << '\n';
-      // ss << "shape["<< idx_s << "].num_faces: "
-      //     <<  static_cast<unsigned long>(shapes[idx_s].mesh.num_face_vertices.size()) << '\n';
-
-      // For each face print out the indices lists.
+      const auto &mesh = shapes[idx_s].mesh;
       size_t index_offset = 0;
       // # of triangles for this "shape" (group).
       // NOTE that we are accumulate the number of triangles coming from the shapes present in the OBJ file.
-      md->n_triangles += shapes[idx_s].mesh.num_face_vertices.size();
-      for ( auto idx_f{0} ; idx_f < md->n_triangles; idx_f++)
+      md->n_triangles += mesh.num_face_vertices.size();
+      for ( auto idx_f{0u} ; idx_f < mesh.num_face_vertices.size(); idx_f++)
       {
           // Number of vertices per face (always 3, in our case)
-          size_t fnum = shapes[idx_s].mesh.num_face_vertices[idx_f];
-
-          // ss << "  face[" << idx_f << "].fnum = "  << static_cast<unsigned long>(fnum) << '\n';
-
-          // TODO: Invert order of vertices if flag is on. (DONE!)
-          if ( rvo == true ) {
-              // ss << "Reverse order\n";
-              // For each vertex in the face print the corresponding indices
-              for (int v = fnum-1; v >= 0 ; v--)
-              {
-                  tinyobj::index_t idx = shapes[idx_s].mesh.indices[index_offset + v];
-                  // ss << "    face[" << idx_f << "].v[" << v << "].indices = "
-                  //     << idx.vertex_index << "/" << idx.normal_index << "/" << idx.texcoord_index << '\n';
-                  // Add the indices to the global list of indices we need to pass on to the mesh object.
-                  md->vertex_indices->push_back( idx.vertex_index );
-                  md->normal_indices->push_back( idx.normal_index );
-                  // md->uvcoord_indices->push_back( idx.texcoord_index );
-              }
-          }
-          else { // Keep the original vertex order
-              // For each vertex in the face get the corresponding indices
-              for (size_t v = 0; v < fnum; v++)
-              {
-                  tinyobj::index_t idx = shapes[idx_s].mesh.indices[index_offset + v];
-                  // ss << "    face[" << idx_f << "].v[" << v << "].indices = "
-                  //     << idx.vertex_index << "/" << idx.normal_index << "/" << idx.texcoord_index << '\n';
-                  // Add the indices to the global list of indices we need to pass on to the mesh object.
-                  // This goes to the mesh data structure.
-                  md->vertex_indices->push_back( idx.vertex_index );
-                  md->normal_indices->push_back( idx.normal_index );
-                  // md->uvcoord_indices->push_back( idx.texcoord_index );
-              }
+          size_t fnum = mesh.num_face_vertices[idx_f];
+
+          for (size_t k = 0; k < fnum; k++)
+          {
+              // Invert order of vertices if flag is on.
+              size_t v = ( rvo ) ? fnum - 1 - k : k;
+              tinyobj::index_t idx = mesh.indices[index_offset + v];
+              // Add the indices to the global list of indices we need to pass on to the mesh object.
+              vertex_indices.push_back( idx.vertex_index );
+              normal_indices.push_back( idx.normal_index );
+              uvcoord_indices.push_back( idx.texcoord_index );
           }
 
           // Advance over to the next triangle.
@@ -287,19 +263,17 @@ void extract_obj_data( const tinyobj::attrib_t& attrib,
       }
   }
 
-//   cout << "This is the list of indices: \n";
-
-//   cout << "   + Vertices [ ";
-//   std::copy( md->vertex_indices->begin(), md->vertex_indices->end(), std::ostream_iterator< int > ( std::cout, " " ) );
-//   cout << "]\n";
-
-//   cout << "   + Normals [ ";
-//   std::copy( md->normal_indices->begin(), md->normal_indices->end(), std::ostream_iterator< int > ( std::cout, " " ) );
-//   cout << "]\n";
+  md->vertices = MeshBuffer<Point3f>{ std::move(vertices) };
+  md->normals = MeshBuffer<Normal3f>{ std::move(normals) };
+  md->uvcoords = MeshBuffer<Point2f>{ std::move(uvcoords) };
+  md->vertex_indices = MeshBuffer<int>{ std::move(vertex_indices) };
+  md->normal_indices = MeshBuffer<int>{ std::move(normal_indices) };
+  md->uvcoord_indices = MeshBuffer<int>{ std::move(uvcoord_indices) };
 
-  // cout << "   + UV coords [ ";
-  // std::copy( md->uvcoord_indices->begin(), md->uvcoord_indices->end(), std::ostream_iterator< int > ( std::cout, " " ) );
-  // cout << "]\n";
+  // Do we need to compute the normals? Yes only if the user requeste or there are no normals in the file.
+  if (cn || n_normals == 0){
+      compute_normals(*md, fn);
+  }
 }
 
 }
\ No newline at end of file
@@ -10,8 +10,8 @@ namespace rt3{
 /// Represents a single triangle.
 class Triangle : public Shape {
 private:
-    shared_ptr<const Point3f> vert[3];
-    shared_ptr<const Normal3f> n[3];
+    const Point3f *vert[3];
+    const Normal3f *n[3];
 
     shared_ptr<TriangleMesh> mesh; //!< This is the **indexed triangle mesh database** this triangle is linked to.
 public:
@@ -19,17 +19,17 @@ public:
     Triangle( shared_ptr<TriangleMesh> mesh, int tri_id)
     : Shape(), mesh{mesh}
     {
-        auto &v_indexes = *(mesh->vertex_indices);
-        auto &n_indexes = *(mesh->normal_indices);
+        auto &v_indexes = mesh->vertex_indices;
+        auto &n_indexes = mesh->normal_indices;
 
-        auto &vertices = *(mesh->vertices);
-        auto &normals = *(mesh->normals);
-        // auto &uvcoords = *(mesh->uvcoords);
+        auto &vertices = mesh->vertices;
+        auto &normals = mesh->normals;
+        // auto &uvcoords = mesh->uvcoords;
 
         // This is just a shortcut to access this triangle's data stored in the mesh database.
         for(int i = 0; i < 3; ++i){
-            vert[i] = vertices[v_indexes[ 3 * tri_id + i]];
-            n[i] = normals[n_indexes[ 3 * tri_id + i]];
+            vert[i] = &vertices[v_indexes[ 3 * tri_id + i]];
+            n[i] = &normals[n_indexes[ 3 * tri_id + i]];
         }
 
     }
@@ -49,9 +49,12 @@ public:
 /// This function creates the internal data structure, required by the RT3.
 vector<Shape*> create_triangles(shared_ptr<TriangleMesh> mesh);
 
-// Loads obj file at filename and then calls extract_obj_data
+// Loads obj file at filename with the multi-threaded reader (see obj_reader.h)
 bool load_mesh_data( const std::string & filename, bool rvo, bool cn, bool fn, shared_ptr<TriangleMesh> md );
 
+// Loads obj file at filename with tinyobjloader and then calls extract_obj_data
+bool load_mesh_data_tinyobj( const std::string & filename, bool rvo, bool cn, bool fn, shared_ptr<TriangleMesh> md );
+
 // Extracts data from attrib and saves into md
 // Calls retrieve functions for each step
 void extract_obj_data( const tinyobj::attrib_t& attrib,
@@ -1,32 +1,24 @@
 #include "triangle_mesh.h"
 
+#include <sys/stat.h>
+
+#include <fstream>
+
 namespace rt3{
 
 TriangleMesh *create_triangle_mesh(const ParamSet &ps){
     auto n = retrieve(ps, "ntriangles", 1);
     auto backface_cull = retrieve(ps, "backface_cull", false);
-    
-    auto indices_vec = retrieve(ps, "indices", std::vector<int>{0,0,0});
-    auto indices = make_shared<vector<int>>(indices_vec);
-
-    auto vertices_vec = retrieve(ps, "vertices", std::vector<Point3f>({{0, -0.5, -0.2}, {0.2, -0.5, -0.2}, {0.3, -0.5, -0.3}}));
-    std::vector<shared_ptr<Point3f>> vec_ptr;
-    for(auto x : vertices_vec) {
-        vec_ptr.push_back(make_shared<Point3f>(x));
-    }
-    auto vertices = make_shared<vector<shared_ptr<Point3f>>>(vec_ptr);
 
+    auto indices = retrieve(ps, "indices", std::vector<int>{0,0,0});
 
-    auto normals_vec = retrieve(ps, "normals", std::vector<Normal3f>({{0, 1, 0}, {0, 1, 0}, {0, 1, 0}}));
-    std::vector<shared_ptr<Normal3f>> norm_ptr;
-    for(auto x : normals_vec) {
-        norm_ptr.push_back(make_shared<Normal3f>(x));
-    }
-    auto normals = make_shared<vector<shared_ptr<Normal3f>>>(norm_ptr);
+    auto vertices = retrieve(ps, "vertices", std::vector<Point3f>({{0, -0.5, -0.2}, {0.2, -0.5, -0.2}, {0.3, -0.5, -0.3}}));
+
+    auto normals = retrieve(ps, "normals", std::vector<Normal3f>({{0, 1, 0}, {0, 1, 0}, {0, 1, 0}}));
 
     if(retrieve(ps, "reverse_vertex_order", false)){
-        auto it = indices->begin();
-        while(it != indices->end()){
+        auto it = indices.begin();
+        while(it != indices.end()){
             reverse(it, it + 3);
             it += 3;
         }
@@ -36,33 +28,109 @@ TriangleMesh *create_triangle_mesh(const ParamSet &ps){
         RT3_ERROR("Not implemented.");
     }
 
-    return new TriangleMesh(n, backface_cull, indices, vertices, normals);
+    MeshBuffer<int> index_buffer{std::move(indices)};
+    return new TriangleMesh(n, backface_cull, index_buffer, index_buffer,
+                            MeshBuffer<Point3f>{std::move(vertices)},
+                            MeshBuffer<Normal3f>{std::move(normals)});
 }
 
-Normal3f compute_normals(shared_ptr<Point3f> a, shared_ptr<Point3f> b, shared_ptr<Point3f> c){
-  Vector3f edges[2] = {*a - *b, *c - *a};
-  return glm::cross(edges[0], edges[1]);
+void compute_normals(TriangleMesh &mesh, bool flip){
+    vector<Normal3f> acc(mesh.vertices.size(), Normal3f{0, 0, 0});
+
+    for(int i = 0; i < mesh.n_triangles; i++) {
+        int a = mesh.vertex_indices[3 * i + 0];
+        int b = mesh.vertex_indices[3 * i + 1];
+        int c = mesh.vertex_indices[3 * i + 2];
+        // The cross product length is twice the triangle's area, so bigger faces weigh more.
+        Normal3f face = glm::cross(mesh.vertices[b] - mesh.vertices[a], mesh.vertices[c] - mesh.vertices[a]);
+        acc[a] += face;
+        acc[b] += face;
+        acc[c] += face;
+    }
+
+    real_type sign = (flip) ? -1 : 1;
+    for(auto &n : acc) {
+        real_type len = glm::length(n);
+        n = (len > 0) ? n * (sign / len) : Normal3f{0, 1, 0};
+    }
+
+    mesh.normals = MeshBuffer<Normal3f>{std::move(acc)};
+    mesh.normal_indices = mesh.vertex_indices;
 }
 
 shared_ptr<TriangleMesh> TriangleMesh::copy_mesh() const{
-    shared_ptr<vector<shared_ptr<Point3f>>> new_verts = make_shared<vector<shared_ptr<Point3f>>>(vector<shared_ptr<Point3f>>());
-    shared_ptr<vector<shared_ptr<Normal3f>>> new_normals = make_shared<vector<shared_ptr<Normal3f>>>(vector<shared_ptr<Normal3f>>());
-
-    for(auto &v : *vertices) new_verts->push_back(make_shared<Point3f>(*v));
-    for(auto &n : *normals) new_normals->push_back(make_shared<Normal3f>(*n));
-    return make_shared<TriangleMesh>(
+    auto copy = make_shared<TriangleMesh>(
         n_triangles,
         backface_cull,
         vertex_indices,
         normal_indices,
-        new_verts,
-        new_normals
-    );  
+        vertices,
+        normals
+    );
+    copy->uvcoord_indices = uvcoord_indices;
+    copy->uvcoords = uvcoords;
+    return copy;
 }
 
 void TriangleMesh::apply_transform(shared_ptr<Transform> t){
-  for(auto v : *vertices) *v = t->apply_p(*v);
-  for(auto n : *normals) *n = t->apply_n(*n);
+  if(t->IsIdentity()) return;
+
+  vector<Point3f> new_verts;
+  new_verts.reserve(vertices.size());
+  for(auto &v : vertices) new_verts.push_back(t->apply_p(v));
+
+  vector<Normal3f> new_normals;
+  new_normals.reserve(normals.size());
+  for(auto &n : normals) new_normals.push_back(t->apply_n(n));
+
+  vertices = MeshBuffer<Point3f>{std::move(new_verts)};
+  normals = MeshBuffer<Normal3f>{std::move(new_normals)};
 }
 
-}
\ No newline at end of file
+Bounds3f TriangleMesh::compute_bounds() const{
+  Bounds3f box;
+  for(auto &v : vertices) {
+    for(int i = 0; i < 3; ++i) {
+      box.min_point[i] = std::min(box.min_point[i], v[i]);
+      box.max_point[i] = std::max(box.max_point[i], v[i]);
+    }
+  }
+  return box;
+}
+
+std::string file_stamp(const std::string &filename){
+    struct stat st;
+    if(stat(filename.c_str(), &st) != 0) return "";
+    return std::to_string(st.st_size) + " " + std::to_string(st.st_mtim.tv_sec) + "."
+         + std::to_string(st.st_mtim.tv_nsec);
+}
+
+bool load_bounds_sidecar(const std::string &mesh_filename, Bounds3f &box){
+    std::ifstream ifs{mesh_filename + ".bounds"};
+    if(!ifs.is_open()) return false;
+
+    Bounds3f read;
+    for(int i = 0; i < 3; ++i) ifs >> read.min_point[i];
+    for(int i = 0; i < 3; ++i) ifs >> read.max_point[i];
+    if(ifs.fail()) return false;
+
+    // Sidecars written by hand have no stamp; those written by save_bounds_sidecar() do.
+    std::string size, mtime;
+    if(ifs >> size >> mtime && size + " " + mtime != file_stamp(mesh_filename)) return false;
+
+    box = read;
+    return true;
+}
+
+bool save_bounds_sidecar(const std::string &mesh_filename, const Bounds3f &box){
+    std::ofstream ofs{mesh_filename + ".bounds"};
+    if(!ofs.is_open()) return false;
+
+    ofs.precision(9);
+    ofs << box.min_point[0] << " " << box.min_point[1] << " " << box.min_point[2] << "\n"
+        << box.max_point[0] << " " << box.max_point[1] << " " << box.max_point[2] << "\n"
+        << file_stamp(mesh_filename) << "\n";
+    return ofs.good();
+}
+
+}
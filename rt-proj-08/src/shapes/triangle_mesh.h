@@ -6,42 +6,65 @@
 
 namespace rt3{
 
+/// Read-only, contiguous array of mesh data.
+/// The elements either live in a vector owned by the buffer or are borrowed from
+/// memory kept alive by `keeper` (e.g. a memory mapped `.rt3mesh` file).
+template <typename T>
+class MeshBuffer {
+public:
+    MeshBuffer() = default;
+
+    /// Takes ownership of the vector's content.
+    MeshBuffer(vector<T> &&v)
+    : owned(std::make_shared<vector<T>>(std::move(v))), ptr(owned->data()), count(owned->size())
+    {/*empty*/}
+
+    /// Borrows `n` elements starting at `p`; no copy is made.
+    MeshBuffer(const T *p, size_t n, std::shared_ptr<const void> keeper)
+    : keeper(std::move(keeper)), ptr(p), count(n)
+    {/*empty*/}
+
+    const T& operator[](size_t i) const { return ptr[i]; }
+    const T* data() const { return ptr; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const T* begin() const { return ptr; }
+    const T* end() const { return ptr + count; }
+
+private:
+    std::shared_ptr<vector<T>> owned;   //!< Storage, when the data belongs to the buffer.
+    std::shared_ptr<const void> keeper; //!< Owner of the borrowed memory, if any.
+    const T *ptr = nullptr;
+    size_t count = 0;
+};
+
 /// This struct implements an indexd triangle mesh database.
 struct TriangleMesh {
-    int n_triangles; //!< # of triangles in the mesh.
-    bool backface_cull;
+    int n_triangles = 0; //!< # of triangles in the mesh.
+    bool backface_cull = false;
 
     // The size of the three lists below should be 3 * nTriangles. Every 3 values we have a triangle.
-    std::shared_ptr<vector<int>> vertex_indices;  //!< The list of indices to the vertex list, for each individual triangle.
-    std::shared_ptr<vector<int>> normal_indices;  //!< The list of indices to the normals list, for each individual triangle.
-    std::shared_ptr<vector<int>> uvcoord_indices; //!< The list of indices to the UV coord list, for each individual triangle.
+    MeshBuffer<int> vertex_indices;  //!< The list of indices to the vertex list, for each individual triangle.
+    MeshBuffer<int> normal_indices;  //!< The list of indices to the normals list, for each individual triangle.
+    MeshBuffer<int> uvcoord_indices; //!< The list of indices to the UV coord list, for each individual triangle.
 
-    std::shared_ptr<vector<std::shared_ptr<Point3f>>> vertices;  //!< The 3D geometric coordinates
-    std::shared_ptr<vector<std::shared_ptr<Normal3f>>> normals;  //!< The 3D normals.
+    MeshBuffer<Point3f> vertices;  //!< The 3D geometric coordinates
+    MeshBuffer<Normal3f> normals;  //!< The 3D normals.
+    MeshBuffer<Point2f> uvcoords;  //!< The 2D texture coordinates.
 
     // Regular constructor
-    TriangleMesh()
-    :vertex_indices(new vector<int>), normal_indices(new vector<int>),
-    vertices(new vector<std::shared_ptr<Point3f>>()), normals(new vector<std::shared_ptr<Normal3f>>())
-    {/*empty*/};
-
-    TriangleMesh(
-    int n, bool bface,
-    std::shared_ptr<vector<int>> indexes,
-    std::shared_ptr<vector<std::shared_ptr<Point3f>>> vertexes,
-    std::shared_ptr<vector<std::shared_ptr<Normal3f>>> normal
-    ):n_triangles(n), backface_cull(bface), vertex_indices(indexes), normal_indices(indexes), 
-    vertices(vertexes), normals(normal){}
+    TriangleMesh() = default;
 
     TriangleMesh(
     int n, bool bface,
-    std::shared_ptr<vector<int>> vertex_indexes,
-    std::shared_ptr<vector<int>> normal_indexes,
-    std::shared_ptr<vector<std::shared_ptr<Point3f>>> vertexes,
-    std::shared_ptr<vector<std::shared_ptr<Normal3f>>> normal
-    ):n_triangles(n), backface_cull(bface), vertex_indices(vertex_indexes), normal_indices(normal_indexes), 
+    MeshBuffer<int> vertex_indexes,
+    MeshBuffer<int> normal_indexes,
+    MeshBuffer<Point3f> vertexes,
+    MeshBuffer<Normal3f> normal
+    ):n_triangles(n), backface_cull(bface), vertex_indices(vertex_indexes), normal_indices(normal_indexes),
     vertices(vertexes), normals(normal){}
 
+    /// Shallow copy: the new mesh shares every buffer with this one.
     std::shared_ptr<TriangleMesh> copy_mesh() const;
 
     TriangleMesh( const TriangleMesh& ) = delete;
@@ -50,11 +73,29 @@ struct TriangleMesh {
     /// Move constructor.
     TriangleMesh( TriangleMesh && other ) = delete;
 
+    /// Replaces the vertex and normal buffers by transformed copies.
     void apply_transform(shared_ptr<Transform> t);
+
+    /// Bounding box of all vertices.
+    Bounds3f compute_bounds() const;
 };
 
 TriangleMesh *create_triangle_mesh(const ParamSet &ps);
 
-Normal3f compute_normals();
+/// Computes one (area weighted) normal per vertex; normal indices become the vertex indices.
+void compute_normals(TriangleMesh &mesh, bool flip);
+
+/// Size and modification time of `filename`, as "<bytes> <seconds>.<nanoseconds>", or an empty
+/// string if it can't be read: tells whether a file changed since it was last looked at.
+std::string file_stamp(const std::string &filename);
+
+/// Reads the bounding box stored next to a mesh file, in `<mesh_filename>.bounds`
+/// (six numbers: min x y z, then max x y z). A sidecar that also holds the `file_stamp()`
+/// of the mesh is stale, and ignored, once the mesh file changes.
+bool load_bounds_sidecar(const std::string &mesh_filename, Bounds3f &box);
+
+/// Writes the `<mesh_filename>.bounds` sidecar read by `load_bounds_sidecar()`, with the
+/// mesh file's current stamp.
+bool save_bounds_sidecar(const std::string &mesh_filename, const Bounds3f &box);
 }
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,124 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../core/error.h"
+#include "../shapes/obj_reader.h"
+#include "../shapes/triangle.h"
+
+using namespace rt3;
+
+void usage(const char* msg = nullptr) {
+  if (msg != nullptr) {
+    std::cout << "rt3_objbench: " << msg << "\n\n";
+  }
+
+  std::cout << "Usage: rt3_objbench [<options>] [<file.obj> ...]\n"
+            << "  Compares tinyobjloader against the multi-threaded OBJ reader.\n"
+            << "  Without files, the benchmark set under scene/models is used.\n"
+            << "  Options:\n"
+            << "    --help                     Print this help text.\n"
+            << "    --threads <n>              Threads of the parallel reader (default: all).\n"
+            << "    --runs <n>                 Runs per reader; the best time is kept (default: 5).\n\n";
+  exit(msg != nullptr ? 1 : 0);
+}
+
+/// Best wall time, in ms, of `runs` calls to `load`.
+template <typename F> double best_of(int runs, F load) {
+  double best = 1e300;
+  for (int r = 0; r < runs; ++r) {
+    auto start = std::chrono::steady_clock::now();
+    load();
+    std::chrono::duration<double, std::milli> diff = std::chrono::steady_clock::now() - start;
+    best = std::min(best, diff.count());
+  }
+  return best;
+}
+
+/// Largest difference between the triangles of both meshes; infinity if they don't match.
+real_type compare(const TriangleMesh& a, const TriangleMesh& b) {
+  if (a.n_triangles != b.n_triangles) {
+    return INFINITY;
+  }
+  real_type diff = 0;
+  for (int i = 0; i < 3 * a.n_triangles; ++i) {
+    const Point3f& pa = a.vertices[a.vertex_indices[i]];
+    const Point3f& pb = b.vertices[b.vertex_indices[i]];
+    const Normal3f& na = a.normals[a.normal_indices[i]];
+    const Normal3f& nb = b.normals[b.normal_indices[i]];
+    for (int k = 0; k < 3; ++k) {
+      diff = std::max(diff, std::abs(pa[k] - pb[k]));
+      diff = std::max(diff, std::abs(na[k] - nb[k]));
+    }
+  }
+  return diff;
+}
+
+int main(int argc, char* argv[]) {
+  unsigned threads{ 0 };
+  int runs{ 5 };
+  std::vector<std::string> files;
+
+  for (int i{ 1 }; i < argc; ++i) {
+    std::string option{ argv[i] };
+    if (option == "--threads") {
+      if (i + 1 == argc) usage("missing value after --threads argument");
+      threads = std::stoi(argv[++i]);
+    } else if (option == "--runs") {
+      if (i + 1 == argc) usage("missing value after --runs argument");
+      runs = std::max(1, std::stoi(argv[++i]));
+    } else if (option == "--help" or option == "-h") {
+      usage();
+    } else {
+      files.push_back(option);
+    }
+  }
+
+  if (files.empty()) {
+    files = { "scene/models/fiat.obj", "scene/models/aranha.obj", "scene/models/teapot.obj" };
+  }
+
+  struct Row {
+    std::string file;
+    int n_triangles;
+    double t_tinyobj, t_parallel;
+    real_type diff;
+  };
+  std::vector<Row> rows;
+
+  // The loaders are chatty; keep the report readable.
+  std::streambuf* cout_buf = std::cout.rdbuf();
+  std::ostringstream sink;
+  for (const auto& f : files) {
+    std::cout.rdbuf(sink.rdbuf());
+    auto ref = std::make_shared<TriangleMesh>();
+    auto par = std::make_shared<TriangleMesh>();
+    bool ok = load_mesh_data_tinyobj(f, false, false, false, ref)
+              and load_obj_parallel(f, false, false, false, par, threads);
+    double t_ref = best_of(runs, [&] { load_mesh_data_tinyobj(f, false, false, false, std::make_shared<TriangleMesh>()); });
+    double t_par = best_of(runs, [&] { load_obj_parallel(f, false, false, false, std::make_shared<TriangleMesh>(), threads); });
+    std::cout.rdbuf(cout_buf);
+    sink.str("");
+
+    if (not ok) {
+      RT3_ERROR("Couldn't load \"" + f + "\"");
+    }
+    rows.push_back({ f, ref->n_triangles, t_ref, t_par, compare(*ref, *par) });
+  }
+
+  std::cout << std::left << std::setw(32) << "file" << std::right << std::setw(10) << "tris"
+            << std::setw(14) << "tinyobj ms" << std::setw(14) << "parallel ms" << std::setw(10)
+            << "speedup" << std::setw(12) << "max diff" << '\n';
+  for (const auto& r : rows) {
+    std::cout << std::left << std::setw(32) << r.file << std::right << std::setw(10) << r.n_triangles
+              << std::fixed << std::setprecision(3) << std::setw(14) << r.t_tinyobj << std::setw(14)
+              << r.t_parallel << std::setw(9) << std::setprecision(2) << r.t_tinyobj / r.t_parallel
+              << "x" << std::setw(12) << std::scientific << std::setprecision(1) << r.diff
+              << std::defaultfloat << '\n';
+  }
+
+  return EXIT_SUCCESS;
+}
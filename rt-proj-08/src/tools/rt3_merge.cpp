@@ -0,0 +1,123 @@
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "../core/error.h"
+#include "../core/image_io.h"
+#include "../core/partial_image.h"
+
+using namespace rt3;
+
+void usage(const char* msg = nullptr) {
+  if (msg != nullptr) {
+    std::cout << "rt3-merge: " << msg << "\n\n";
+  }
+
+  std::cout << "Usage: rt3-merge [<options>] <part.rt3part>...\n"
+            << "  Puts together the .rt3part files written by `rt3 --bucket` or `rt3 --tile-range`\n"
+            << "  and writes the final image, in the format the scene asks for.\n"
+            << "  Options:\n"
+            << "    --help                     Print this help text.\n"
+            << "    --outfile <filename>       Write the image to <filename> instead of the\n"
+            << "                               scene's output file.\n"
+            << "    --allow-missing            Leave missing tiles black instead of failing.\n\n";
+  exit(msg != nullptr ? 1 : 0);
+}
+
+int main(int argc, char* argv[]) {
+  bool allow_missing{ false };
+  std::string outfile;
+  std::vector<std::string> inputs;
+
+  for (int i{ 1 }; i < argc; ++i) {
+    std::string option{ argv[i] };
+    if (option == "--outfile" or option == "-o") {
+      if (i + 1 == argc) {
+        usage("missing value after --outfile argument");
+      }
+      outfile = argv[++i];
+    } else if (option == "--allow-missing") {
+      allow_missing = true;
+    } else if (option == "--help" or option == "-h") {
+      usage();
+    } else {
+      inputs.push_back(option);
+    }
+  }
+
+  if (inputs.empty()) {
+    usage("no .rt3part file given");
+  }
+
+  PartialImage first;
+  std::unique_ptr<Film::ColorBuffer> image;
+  std::vector<int> owner;  // Input each tile came from, or -1.
+
+  for (size_t k = 0; k < inputs.size(); ++k) {
+    PartialImage part;
+    if (not load_partial_image(inputs[k], part)) {
+      RT3_ERROR("Couldn't read \"" + inputs[k] + "\"");
+    }
+    if (k == 0) {
+      first = part;
+      image = std::make_unique<Film::ColorBuffer>(part.header.height, part.header.width);
+      owner.assign(part.header.total_tiles, -1);
+    } else if (not part.same_frame(first)) {
+      RT3_ERROR("\"" + inputs[k] + "\" was rendered with a different scene, tile layout or sampling than \""
+                + inputs[0] + "\"");
+    }
+
+    const float* rgb = part.rgb.data();
+    for (int id : part.tiles) {
+      if (owner[id] != -1) {
+        RT3_ERROR("Tile " + std::to_string(id) + " is both in \"" + inputs[owner[id]] + "\" and in \"" + inputs[k]
+                  + "\"");
+      }
+      owner[id] = k;
+      Film::PixelWindow t = part.crop().tile(part.header.tile_size, id);
+      for (int i = t.i0; i < t.i1; i++) {
+        for (int j = t.j0; j < t.j1; j++) {
+          image->mat[i][j] = Color{ rgb[0], rgb[1], rgb[2] };
+          rgb += 3;
+        }
+      }
+    }
+  }
+
+  int missing = 0;
+  for (int o : owner) {
+    missing += (o == -1);
+  }
+  if (missing > 0) {
+    std::string msg = std::to_string(missing) + " of " + std::to_string(owner.size()) + " tiles are missing";
+    if (not allow_missing) {
+      RT3_ERROR(msg + "; pass --allow-missing to write the image anyway.");
+    }
+    RT3_WARNING(msg + "; they are left black.");
+  }
+
+  const RT3PartHeader& header = first.header;
+  Film::PixelWindow out = header.write_cropped ? first.crop() : Film::PixelWindow{ 0, header.height, 0, header.width };
+  if (outfile.empty()) {
+    outfile = first.filename;
+  }
+
+  bool ok = false;
+  auto type = static_cast<Film::image_type_e>(header.image_type);
+  if (type == Film::image_type_e::PNG) {
+    std::vector<byte> bytes = image->get_byte_arr(4, out.i0, out.i1, out.j0, out.j1);
+    ok = save_png(bytes.data(), out.width(), out.height(), 4, outfile);
+  } else if (type == Film::image_type_e::PPM3) {
+    std::vector<byte> bytes = image->get_byte_arr(3, out.i0, out.i1, out.j0, out.j1);
+    ok = save_ppm3(bytes.data(), out.width(), out.height(), 3, outfile);
+  } else if (type == Film::image_type_e::PPM6) {
+    std::vector<byte> bytes = image->get_byte_arr(3, out.i0, out.i1, out.j0, out.j1);
+    ok = save_ppm6(bytes.data(), out.width(), out.height(), 3, outfile);
+  }
+  if (not ok) {
+    RT3_ERROR("Couldn't write \"" + outfile + "\"");
+  }
+
+  RT3_MESSAGE("Merged " + std::to_string(inputs.size()) + " pieces into " + outfile);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,308 @@
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../core/api.h"
+#include "../core/error.h"
+#include "../core/rt3.h"
+#include "../shapes/triangle_mesh.h"
+
+using namespace rt3;
+
+/// Seconds a client has, once connected, to send its job line.
+constexpr int CLIENT_TIMEOUT_S = 10;
+
+void usage(const char* msg = nullptr) {
+  if (msg != nullptr) {
+    std::cout << "rt3d: " << msg << "\n\n";
+  }
+
+  std::cout << "Usage: rt3d <socket>\n"
+            << "  Stays running and renders the jobs sent to the Unix socket <socket>, keeping the\n"
+            << "  meshes read and their accelerators from job to job.\n"
+            << "       rt3d --submit <socket> <input_scene_file> [<options>]\n"
+            << "  Sends a job to a running rt3d and prints its reply; `rt3d --submit <socket> shutdown`\n"
+            << "  stops it.\n"
+            << "  Job options:\n"
+            << "    --outfile <filename>       Write the rendered image to <filename>.\n"
+            << "    --cropwindow <x0 x1 y0 y1> Specify an image crop window.\n"
+            << "    --resolution <W> <H>       Render at W x H pixels instead of the scene's resolution.\n"
+            << "    --quick                    Render at 1/4 of the resolution.\n"
+            << "    --threads <N>              Render with N threads (default: one per core).\n"
+            << "    --no-packets               Trace every primary ray on its own.\n"
+            << "    --denoise                  Filter the image before writing it.\n\n"
+            << "  A job is one line of text: the scene file and its options, separated by spaces.\n"
+            << "  The reply is one line, \"ok\" and the job's timings, or \"error\" and what went wrong.\n"
+            << "  The line \"shutdown\" stops the daemon. Relative paths in a scene are taken from\n"
+            << "  the daemon's working directory; --submit makes the scene and output paths absolute.\n\n";
+  exit(msg != nullptr ? 1 : 0);
+}
+
+/// Reads the words of a job line into `opt`; returns what is wrong with them, if anything.
+std::string parse_job(const std::vector<std::string>& words, RunningOptions& opt) {
+  for (size_t i{ 0 }; i < words.size(); ++i) {
+    const std::string& option = words[i];
+    auto has = [&](size_t n) { return i + n < words.size(); };
+    if (option == "--outfile" or option == "-o") {
+      if (not has(1)) return "missing value after --outfile";
+      opt.outfile = words[++i];
+    } else if (option == "--cropwindow" or option == "--crop") {
+      if (not has(4)) return "missing values after --cropwindow";
+      opt.crop_window[0][0] = std::stof(words[++i]);
+      opt.crop_window[0][1] = std::stof(words[++i]);
+      opt.crop_window[1][0] = std::stof(words[++i]);
+      opt.crop_window[1][1] = std::stof(words[++i]);
+    } else if (option == "--resolution") {
+      if (not has(2)) return "missing values after --resolution";
+      opt.x_res = std::stoi(words[++i]);
+      opt.y_res = std::stoi(words[++i]);
+      if (opt.x_res < 1 or opt.y_res < 1) return "--resolution must be at least 1 x 1";
+    } else if (option == "--quick" or option == "-q") {
+      opt.quick_render = true;
+    } else if (option == "--threads" or option == "-t") {
+      if (not has(1)) return "missing value after --threads";
+      opt.n_threads = std::stoi(words[++i]);
+      if (opt.n_threads < 1) return "--threads must be at least 1";
+    } else if (option == "--no-packets") {
+      opt.ray_packets = false;
+    } else if (option == "--denoise") {
+      opt.denoise = true;
+    } else if (option[0] == '-') {
+      return "unknown option " + option;
+    } else {
+      opt.filename = option;
+    }
+  }
+  if (opt.filename.empty()) return "no scene file given";
+  return "";
+}
+
+/// Drops from `API::meshes` the meshes whose file changed since it was last seen, so that they are
+/// read again; `stamps` holds the `file_stamp()` each file had then.
+void check_meshes(std::map<std::string, std::string>& stamps) {
+  for (auto it = API::meshes.begin(); it != API::meshes.end();) {
+    std::string stamp = file_stamp(it->first);
+    auto seen = stamps.find(it->first);
+    if (seen != stamps.end() and seen->second != stamp) {
+      RT3_MESSAGE("    \"" + it->first + "\" changed; it will be read again.\n");
+      stamps.erase(seen);
+      it = API::meshes.erase(it);
+    } else {
+      stamps[it->first] = stamp;
+      ++it;
+    }
+  }
+}
+
+/// Renders a job; returns the reply line.
+std::string run_job(const RunningOptions& opt) {
+  auto start = std::chrono::steady_clock::now();
+  try {
+    API::init_engine(opt);
+    API::run();
+    API::clean_up();
+  } catch (const std::exception& e) {
+    // RT3Error, or whatever else a render thread threw.
+    API::abort_job();
+    return std::string{ "error " } + e.what();
+  }
+  double total_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+  // Parsing includes reading the meshes that are not in the cache.
+  const JobStats& stats = API::job_stats;
+  std::ostringstream oss;
+  oss << "ok total_ms=" << total_ms << " parse_ms=" << total_ms - stats.build_ms - stats.render_ms
+      << " build_ms=" << stats.build_ms << " render_ms=" << stats.render_ms
+      << " scenes_built=" << stats.scenes_built << " scenes_reused=" << stats.scenes_reused
+      << " mesh_accelerators_reused=" << stats.mesh_accelerators_reused << "/" << stats.mesh_accelerators;
+  return oss.str();
+}
+
+sockaddr_un socket_address(const std::string& path) {
+  sockaddr_un addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path)) {
+    RT3_ERROR("Socket path \"" + path + "\" is too long.");
+  }
+  std::strcpy(addr.sun_path, path.c_str());
+  return addr;
+}
+
+/// Reads from `fd` up to a newline or the end of the stream into `line`; false if reading
+/// failed first, e.g. because the socket's receive timeout ran out.
+bool read_line(int fd, std::string& line) {
+  line.clear();
+  char c;
+  ssize_t n;
+  while ((n = ::read(fd, &c, 1)) == 1 and c != '\n') {
+    line += c;
+  }
+  return n >= 0;
+}
+
+void write_line(int fd, const std::string& line) {
+  std::string data = line + "\n";
+  for (size_t done = 0; done < data.size();) {
+    ssize_t n = ::write(fd, data.data() + done, data.size() - done);
+    if (n <= 0) return;
+    done += n;
+  }
+}
+
+int serve(const std::string& path) {
+  sockaddr_un addr = socket_address(path);
+  int server = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (server < 0) {
+    RT3_ERROR("Could not create a socket.");
+  }
+  // A socket left behind by a daemon that is gone would make bind() fail.
+  struct stat st;
+  if (stat(path.c_str(), &st) == 0 and S_ISSOCK(st.st_mode)) {
+    int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    bool in_use = connect(probe, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+    ::close(probe);
+    if (in_use) {
+      RT3_ERROR("Another rt3d is listening on \"" + path + "\".");
+    }
+    unlink(path.c_str());
+  }
+  if (bind(server, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 or listen(server, 8) != 0) {
+    RT3_ERROR("Could not listen on \"" + path + "\".");
+  }
+  // A client that leaves before its reply must not take the daemon down with it.
+  std::signal(SIGPIPE, SIG_IGN);
+  // From here on a bad job fails alone.
+  throw_on_error(true);
+  RT3_MESSAGE("rt3d: listening on " + path + "\n");
+
+  std::map<std::string, std::string> stamps;
+  for (;;) {
+    int client = accept(server, nullptr, nullptr);
+    if (client < 0) continue;
+
+    // A client that connects and never sends its job must not hold the daemon up.
+    timeval timeout{ CLIENT_TIMEOUT_S, 0 };
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    std::string line;
+    if (not read_line(client, line)) {
+      RT3_MESSAGE("rt3d: no job within " + std::to_string(CLIENT_TIMEOUT_S) + " s; dropping the client\n");
+      write_line(client, "error no job received within " + std::to_string(CLIENT_TIMEOUT_S) + " s");
+      ::close(client);
+      continue;
+    }
+    std::istringstream iss{ line };
+    std::vector<std::string> words;
+    for (std::string word; iss >> word;) {
+      words.push_back(word);
+    }
+
+    if (words.size() == 1 and words[0] == "shutdown") {
+      write_line(client, "ok");
+      ::close(client);
+      break;
+    }
+
+    RunningOptions opt;
+    opt.resident = true;
+    std::string reply;
+    try {
+      reply = parse_job(words, opt);
+      reply = reply.empty() ? "" : "error " + reply;
+    } catch (const std::exception&) {
+      reply = "error bad value in \"" + line + "\"";
+    }
+    if (reply.empty()) {
+      check_meshes(stamps);
+      reply = run_job(opt);
+      check_meshes(stamps);
+    }
+    RT3_MESSAGE("rt3d: " + line + "\n      " + reply + "\n");
+    write_line(client, reply);
+    ::close(client);
+  }
+
+  ::close(server);
+  unlink(path.c_str());
+  return EXIT_SUCCESS;
+}
+
+/// Absolute version of `path`, from the current directory.
+std::string absolute(const std::string& path) {
+  if (path.empty() or path[0] == '/') return path;
+  char cwd[4096];
+  return getcwd(cwd, sizeof(cwd)) ? std::string(cwd) + "/" + path : path;
+}
+
+int submit(const std::string& path, int argc, char* argv[]) {
+  // The daemon has its own working directory: the scene and the output file go as absolute paths.
+  std::vector<std::string> words;
+  for (int i{ 0 }; i < argc; ++i) {
+    std::string word{ argv[i] };
+    int n_values = (word == "--cropwindow" or word == "--crop") ? 4
+                 : (word == "--resolution")                      ? 2
+                 : (word == "--threads" or word == "-t")         ? 1
+                                                                 : 0;
+    if ((word == "--outfile" or word == "-o") and i + 1 < argc) {
+      words.push_back(word);
+      words.push_back(absolute(argv[++i]));
+    } else if (n_values > 0) {
+      words.push_back(word);
+      for (; n_values > 0 and i + 1 < argc; --n_values) {
+        words.push_back(argv[++i]);
+      }
+    } else if (argc == 1 and word == "shutdown") {
+      words.push_back(word);
+    } else {
+      words.push_back(word[0] == '-' ? word : absolute(word));
+    }
+  }
+  std::string line;
+  for (const std::string& word : words) {
+    line += (line.empty() ? "" : " ") + word;
+  }
+
+  sockaddr_un addr = socket_address(path);
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 or connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+    RT3_ERROR("No rt3d is listening on \"" + path + "\".");
+  }
+  write_line(fd, line);
+  std::string reply;
+  read_line(fd, reply);
+  ::close(fd);
+
+  std::cout << reply << '\n';
+  return reply.compare(0, 2, "ok") == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    usage();
+  }
+  std::string option{ argv[1] };
+  if (option == "--help" or option == "-h") {
+    usage();
+  }
+  if (option == "--submit") {
+    if (argc < 4) {
+      usage("--submit needs a socket and a job");
+    }
+    return submit(argv[2], argc - 3, argv + 3);
+  }
+  if (argc != 2) {
+    usage("rt3d takes just the socket to listen on");
+  }
+  return serve(option);
+}
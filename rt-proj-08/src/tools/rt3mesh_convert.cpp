@@ -0,0 +1,70 @@
+#include <iostream>
+#include <string>
+
+#include "../core/error.h"
+#include "../shapes/ply_reader.h"
+#include "../shapes/rt3mesh.h"
+#include "../shapes/triangle.h"
+
+using namespace rt3;
+
+void usage(const char* msg = nullptr) {
+  if (msg != nullptr) {
+    std::cout << "rt3mesh_convert: " << msg << "\n\n";
+  }
+
+  std::cout << "Usage: rt3mesh_convert [<options>] <input.obj|.ply> <output.rt3mesh>\n"
+            << "  Converts an OBJ or PLY mesh into the memory mappable .rt3mesh format.\n"
+            << "  Options:\n"
+            << "    --help                     Print this help text.\n"
+            << "    --reverse-vertex-order     Flip the triangles' winding.\n"
+            << "    --compute-normals          Ignore the file's normals and compute new ones.\n"
+            << "    --flip-normals             Invert the normals.\n"
+            << "    --backface-cull            Store the mesh with backface culling on.\n\n";
+  exit(msg != nullptr ? 1 : 0);
+}
+
+int main(int argc, char* argv[]) {
+  bool rvo{ false }, cn{ false }, fn{ false }, cull{ false };
+  std::string input, output;
+
+  for (int i{ 1 }; i < argc; ++i) {
+    std::string option{ argv[i] };
+    if (option == "--reverse-vertex-order") {
+      rvo = true;
+    } else if (option == "--compute-normals") {
+      cn = true;
+    } else if (option == "--flip-normals") {
+      fn = true;
+    } else if (option == "--backface-cull") {
+      cull = true;
+    } else if (option == "--help" or option == "-h") {
+      usage();
+    } else if (input.empty()) {
+      input = option;
+    } else if (output.empty()) {
+      output = option;
+    } else {
+      usage("too many arguments");
+    }
+  }
+
+  if (input.empty() or output.empty()) {
+    usage("missing input or output file");
+  }
+
+  auto mesh = std::make_shared<TriangleMesh>();
+  bool loaded = is_ply_file(input) ? load_ply(input, rvo, cn, fn, mesh)
+                                   : load_mesh_data(input, rvo, cn, fn, mesh);
+  if (not loaded) {
+    RT3_ERROR("Couldn't load mesh file \"" + input + "\"");
+  }
+  mesh->backface_cull = cull;
+
+  if (not save_rt3mesh(output, *mesh)) {
+    RT3_ERROR("Couldn't write \"" + output + "\"");
+  }
+
+  RT3_MESSAGE("Wrote " + std::to_string(mesh->n_triangles) + " triangles to " + output);
+  return EXIT_SUCCESS;
+}